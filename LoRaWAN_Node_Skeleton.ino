@@ -46,8 +46,35 @@
 
 /* Includes */
 #include "_configurations.h"
+#ifdef USE_DUAL_CORE
+#include "_dual_core.h"
+#endif
+#include "_profiler.h"
 #include "_credentials.h"
+#ifdef USE_CREDENTIALS_STORE
+#include "_credentials_store.h"
+#endif
+#include "_network_profiles.h"
+#include "_crypto.h"
 #include "_logs.h"
+#ifdef USE_METER
+#include "_meter.h"
+#endif
+#ifdef USE_EVENT_DETECTION
+#include "_events.h"
+#endif
+#ifdef USE_ENERGY_ACCUMULATOR
+#include "_energy.h"
+#endif
+#ifdef USE_FUOTA
+#include "_fuota.h"
+#endif
+#ifdef USE_SUPERVISOR
+#include "_supervisor.h"
+#endif
+#if defined(USE_OTAA) && defined(USE_JOIN_SCHEDULER)
+#include "_join.h"
+#endif
 #include "_uplinks.h"
 #include "_downlinks.h"
 #include <lmic.h>
@@ -56,6 +83,18 @@
 /* Instances */
 static osjob_t blinkjob;
 static osjob_t sendjob;
+#if !(defined(USE_OTAA) && defined(USE_JOIN_SCHEDULER))
+static osjob_t failoverjob;
+#endif
+#ifdef USE_METER
+static osjob_t samplejob;
+#endif
+#if defined(USE_OTAA) && defined(USE_JOIN_SCHEDULER)
+static osjob_t joinjob;
+#endif
+#ifdef USE_FUOTA
+static osjob_t fuotajob;
+#endif
 
 /* Pin mapping */
 /* LMiC GPIO configuration */
@@ -113,105 +152,14 @@ void channelsControl()
         LMIC_disableChannel(channel);
     }
     
-#ifdef USE_ABP
-#ifdef USE_CHIRPSTACK_AU915
-    /* ChirpStack AU915 */
-    LMIC_enableChannel(8);
-    LMIC_enableChannel(9);
-    LMIC_enableChannel(10);
-    LMIC_enableChannel(11);
-    LMIC_enableChannel(12);
-    LMIC_enableChannel(13);
-    LMIC_enableChannel(14);
-    LMIC_enableChannel(15);
-    LMIC_enableChannel(65); /* Test */
-#endif
-#ifdef USE_CHIRPSTACK_AU915LA
-    /* ChirpStack AU915LA */
-    LMIC_enableChannel(0);
-    LMIC_enableChannel(1);
-    LMIC_enableChannel(2);
-    LMIC_enableChannel(3);
-    LMIC_enableChannel(4);
-    LMIC_enableChannel(5);
-    LMIC_enableChannel(6);
-    LMIC_enableChannel(7);
-    LMIC_enableChannel(64); /* Test */
-#endif
-#ifdef USE_EVERYNET_AU915LA
-    /* Rede ATC (Everynet) AU915LA */
-    LMIC_enableChannel(0);
-    LMIC_enableChannel(1);
-    LMIC_enableChannel(2);
-    LMIC_enableChannel(3);
-    LMIC_enableChannel(4);
-    LMIC_enableChannel(5);
-    LMIC_enableChannel(6);
-    LMIC_enableChannel(7);
-#endif
-#ifdef USE_THETHINGSNETWORK_AU915
-    /* Rede TTN AU915 */
-    LMIC_enableChannel(8);
-    LMIC_enableChannel(9);
-    LMIC_enableChannel(10);
-    LMIC_enableChannel(11);
-    LMIC_enableChannel(12);
-    LMIC_enableChannel(13);
-    LMIC_enableChannel(14);
-    LMIC_enableChannel(15);
-    LMIC_enableChannel(65); /* Test */
-#endif
-#endif
-
-#ifdef USE_OTAA
-#ifdef USE_CHIRPSTACK_AU915
-    /* ChirpStack AU915 */
-    LMIC_enableChannel(8);
-    LMIC_enableChannel(9);
-    LMIC_enableChannel(10);
-    LMIC_enableChannel(11);
-    LMIC_enableChannel(12);
-    LMIC_enableChannel(13);
-    LMIC_enableChannel(14);
-    LMIC_enableChannel(15);
-    LMIC_enableChannel(65); /* Test */
-#endif
-#ifdef USE_CHIRPSTACK_AU915LA
-    /* ChirpStack AU915LA */
-    LMIC_enableChannel(0);
-    LMIC_enableChannel(1);
-    LMIC_enableChannel(2);
-    LMIC_enableChannel(3);
-    LMIC_enableChannel(4);
-    LMIC_enableChannel(5);
-    LMIC_enableChannel(6);
-    LMIC_enableChannel(7);
-    LMIC_enableChannel(64); /* Test */
-#endif
-#ifdef USE_EVERYNET_AU915LA
-    /* Rede ATC (Everynet) AU915LA */
-    LMIC_enableChannel(0);
-    LMIC_enableChannel(1);
-    LMIC_enableChannel(2);
-    LMIC_enableChannel(3);
-    LMIC_enableChannel(4);
-    LMIC_enableChannel(5);
-    LMIC_enableChannel(6);
-    LMIC_enableChannel(7);
-#endif
-#ifdef USE_THETHINGSNETWORK_AU915
-    /* Rede TTN AU915 */
-    LMIC_enableChannel(8);
-    LMIC_enableChannel(9);
-    LMIC_enableChannel(10);
-    LMIC_enableChannel(11);
-    LMIC_enableChannel(12);
-    LMIC_enableChannel(13);
-    LMIC_enableChannel(14);
-    LMIC_enableChannel(15);
-    LMIC_enableChannel(65); /* Test */
-#endif
-#endif
+    /* Channels of the current network profile (see _network_profiles.h) */
+    for (u1_t channel = 0; channel < 72; ++channel)
+    {
+        if (networkChannelEnabled(channel))
+        {
+            LMIC_enableChannel(channel);
+        }
+    }
 
 #ifdef GATEWAY_SINGLE_CHANNEL
     /* Channels Control */
@@ -228,9 +176,154 @@ void channelsControl()
 #endif
 }
 
+#if !(defined(USE_OTAA) && defined(USE_JOIN_SCHEDULER))
+/* 
+ *  Restart the join on the network selected by networkJoinFailed().
+ *  Scheduled from onEvent() so LMiC is not reset inside its own callback.
+ */
+void failoverfunc(osjob_t *job)
+{
+    #ifdef DEBUG
+    DEBUG_PORT.println(" [INFO] Failover to network : " + String(networkCurrent));
+    #endif
+    
+    LMIC_reset();
+    channelsControl();
+    LMIC_startJoining();
+    
+    /* LMIC_reset() dropped the queued uplink, queue it again so it goes out once joined */
+    do_send(&sendjob);
+}
+#endif
+
+#if defined(USE_OTAA) && defined(USE_JOIN_SCHEDULER)
+/* Starts a join round (see _join.h) */
+void joinfunc(osjob_t *job)
+{
+    LMIC_reset();
+    channelsControl();
+    LMIC_startJoining();
+    
+    /* Taken by LMiC for the first join request of the round */
+    LMIC.txChnl = joinNextChannel();
+    LMIC.datarate = joinRoundStart();
+    
+    #ifdef DEBUG
+    DEBUG_PORT.println(" [INFO] Join round          : " + String(joinRound) + ", channel " + String(LMIC.txChnl) + ", DR" + String(LMIC.datarate));
+    #endif
+    
+    /* Queues the first uplink, it goes out once joined */
+    do_send(&sendjob);
+}
+
+/* Stops LMiC until the next join round */
+void joinpausefunc(osjob_t *job)
+{
+    u4_t delayMs = joinRoundFailed(millis());
+    
+    #ifdef DEBUG
+    DEBUG_PORT.println(" [INFO] Join backoff        : " + String(delayMs / 1000) + " s");
+    #endif
+    
+    LMIC_reset();
+    
+    /* After NETWORK_FAILOVER_JOIN_FAILURES rounds, the next round joins the next network */
+    networkJoinFailed();
+    
+    os_setTimedCallback(job, os_getTime() + ms2osticks(delayMs), joinfunc);
+}
+#endif
+
+#ifdef USE_FUOTA
+/* 
+ *  Erases, rebuilds and checks the FUOTA image a step at a time (see _fuota.h),
+ *  so the LMiC run loop keeps its timing. Scheduled from onEvent().
+ */
+void fuotafunc(osjob_t *job)
+{
+    /* Flash operations stall the CPU, stay away from the RX windows */
+    if (LMIC.opmode & OP_TXRXPEND)
+    {
+        os_setTimedCallback(job, os_getTime() + ms2osticks(FUOTA_WORK_RETRY_MS), fuotafunc);
+        return;
+    }
+    
+    if (fuotaWork())
+    {
+        os_setCallback(job, fuotafunc);
+        return;
+    }
+    
+    #ifdef DEBUG
+    DEBUG_PORT.println(" [INFO] FUOTA state         : " + String(fuota.state) + ", missing " + String(fuotaMissing()));
+    #endif
+    
+    /* Tells the server the session may go on, or how it ended */
+    payloadFuotaStatus();
+}
+#endif
+
+#ifdef USE_SUPERVISOR
+/* Recovery actions of the supervisor (see _supervisor.h) */
+void supervisorRecover(u1_t level)
+{
+    #ifdef DEBUG
+    DEBUG_PORT.println(" [INFO] Supervisor level    : " + String(level) + ", reason " + String(supervisorContext.reason));
+    #endif
+    
+    if (level == SUPERVISOR_LEVEL_CLEAR)
+    {
+        /* Drops the stuck frame, the report goes out in its place */
+        LMIC_clrTxData();
+        os_setCallback(&sendjob, do_send);
+    }
+    else if (level == SUPERVISOR_LEVEL_REJOIN)
+    {
+        #ifndef USE_OTAA
+        /* ABP keeps its session, LMIC_reset() clears the frame counter */
+        u4_t seqnoUp = LMIC.seqnoUp;
+        #endif
+        
+        LMIC_reset();
+        channelsControl();
+        #if defined(USE_OTAA) && defined(USE_JOIN_SCHEDULER)
+        os_setCallback(&joinjob, joinfunc);
+        #elif defined(USE_OTAA)
+        LMIC_startJoining();
+        
+        /* LMIC_reset() dropped the queued uplink, the report goes out once joined */
+        do_send(&sendjob);
+        #else
+        /* Same session as in setup(), without rewinding the frame counter */
+        networkSetSession();
+        LMIC_setSeqnoUp(seqnoUp);
+        LMIC.dn2Dr = networkProfile.dn2Dr;
+        LMIC_setAdrMode(ADR_MODE);
+        if (ADR_MODE != 1)
+        {
+            LMIC_setDrTxpow(UPLINK_DATA_RATE, TRANSMIT_POWER);
+        }
+        LMIC_setLinkCheckMode(LINK_CHECK_MODE);
+        downlinksControlTime();
+        os_setCallback(&sendjob, do_send);
+        #endif
+    }
+    else
+    {
+        supervisorRestart();
+    }
+}
+#endif
+
 /* LMiC Events */
 void onEvent(ev_t ev)
 {
+    PROFILE_SCOPE(PROFILER_EVENT(ev));
+    
+    #ifdef USE_SUPERVISOR
+    supervisorEvent(ev);
+    #endif
+    
     #ifdef DEBUG
     DEBUG_PORT.print(os_getTime());
     DEBUG_PORT.print(": ");
@@ -283,9 +376,16 @@ void onEvent(ev_t ev)
         /* Cancel blink job */
         os_clearCallback(&blinkjob);
         
+        /* Network profile is working, reset the failover counter */
+        networkJoined();
+        
+        #if defined(USE_OTAA) && defined(USE_JOIN_SCHEDULER)
+        joinSucceeded();
+        #endif
+        
         /* Downlink datarate */
         /* The Things Networks uses SF9 for its RX2 window */
-        LMIC.dn2Dr = DN2DR;
+        LMIC.dn2Dr = networkProfile.dn2Dr;
         
         LMIC_setAdrMode(ADR_MODE);
         
@@ -319,6 +419,20 @@ void onEvent(ev_t ev)
         #ifdef DEBUG
         DEBUG_PORT.println(F("EV_JOIN_FAILED"));
         #endif
+        
+        #if defined(USE_OTAA) && defined(USE_JOIN_SCHEDULER)
+        /* Ends the round, failover is handled between rounds */
+        if (joinGiveUp())
+        {
+            os_setCallback(&joinjob, joinpausefunc);
+        }
+        #else
+        /* After NETWORK_FAILOVER_JOIN_FAILURES in a row, join the next network */
+        if (networkJoinFailed())
+        {
+            os_setCallback(&failoverjob, failoverfunc);
+        }
+        #endif
         break;
     case EV_REJOIN_FAILED:
         #ifdef DEBUG
@@ -337,6 +451,14 @@ void onEvent(ev_t ev)
         /* Downlink rules */
         downlinksRule();
         
+        #ifdef USE_FUOTA
+        /* Erase, rebuild or check of the image left by the downlink */
+        if (fuotaBusy())
+        {
+            os_setCallback(&fuotajob, fuotafunc);
+        }
+        #endif
+        
         /* Variable to Log TX or RX */
         modeOperation = "RX";
         
@@ -372,6 +494,19 @@ void onEvent(ev_t ev)
         DEBUG_PORT.println(F("EV_LINK_ALIVE"));
         #endif
         break;
+    case EV_JOIN_TXCOMPLETE:
+        #ifdef DEBUG
+        DEBUG_PORT.println(F("EV_JOIN_TXCOMPLETE"));
+        #endif
+        
+        #if defined(USE_OTAA) && defined(USE_JOIN_SCHEDULER)
+        /* No Join Accept, back off after JOIN_ATTEMPTS_PER_ROUND */
+        if (joinAttempt(LMIC.datarate, millis()))
+        {
+            os_setCallback(&joinjob, joinpausefunc);
+        }
+        #endif
+        break;
     default:
         #ifdef DEBUG
         DEBUG_PORT.println(F("Unknown event"));
@@ -386,6 +521,8 @@ void onEvent(ev_t ev)
  */
 void do_send(osjob_t *j)
 {
+    PROFILE_SCOPE(PROFILER_DO_SEND);
+    
     /* Check if there is not a current TX/RX job running */
     if (LMIC.opmode & OP_TXRXPEND)
     {
@@ -397,7 +534,22 @@ void do_send(osjob_t *j)
     {
         /* Send LoRa Packet */        
         /* Calls uplink sending function */
-        payloadMyNameVerticalBytes();
+        #ifdef USE_SUPERVISOR
+        if (supervisorReportPending)
+        {
+            /* First uplink after a recovery */
+            payloadSupervisorReport();
+            supervisorReported();
+        }
+        else
+        #endif
+        {
+            #ifdef USE_ENERGY_ACCUMULATOR
+            payloadEnergy();
+            #else
+            payloadMyNameVerticalBytes();
+            #endif
+        }
         
         /* Variable to Log TX or RX */
         modeOperation = "TX";
@@ -421,6 +573,120 @@ void do_send(osjob_t *j)
     /* Next TX is scheduled after TX_COMPLETE event */
 }
 
+#ifdef USE_EVENT_DETECTION
+/* 
+ *  Priority uplink, takes the place of the next scheduled do_send().
+ *  Same timing restrictions as do_send(): no logs before the packet is queued.
+ */
+void do_send_event(osjob_t *j)
+{
+    if (LMIC.opmode & OP_TXRXPEND)
+    {
+        /* Events stay pending, the next sample tries again */
+        return;
+    }
+    
+    if (!eventsAirtimeTake(LMIC.datarate, millis()))
+    {
+        /* Out of airtime budget, the events go out later or with the next retry */
+        return;
+    }
+    
+    /* The regular cadence restarts from EV_TXCOMPLETE */
+    os_clearCallback(&sendjob);
+    
+    /* Encoded in place, see payloadTransmit() */
+    u1_t length = eventsPayload(LMIC.pendTxData);
+    LMIC_setTxData2(EVENTS_UPLINK_PORT, NULL, length, 0);
+    
+    /* Variable to Log TX or RX */
+    modeOperation = "TX";
+    
+    #ifdef DEBUG
+    DEBUG_PORT.println(" [INFO] Event uplink            : x" + String(LMIC.pendTxData[0], HEX));
+    #endif
+    
+    /* Counters Control */
+    seqNoUp = LMIC.seqnoUp;
+}
+#endif
+
+#ifdef USE_METER
+#ifdef USE_DUAL_CORE
+/* Worker core: Modbus reads only, away from the LMiC task */
+void metertask(void *parameter)
+{
+    meterReading_t reading;
+    TickType_t wake = xTaskGetTickCount();
+    
+    for (;;)
+    {
+        meterRead(&reading);
+        meterQueue.push(reading);
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(METER_SAMPLE_INTERVAL_MS));
+    }
+}
+#endif
+
+void samplefunc(osjob_t *job)
+{
+#ifdef USE_DUAL_CORE
+    /* 
+     *  Readings of metertask(), nothing here waits on the meter. The energy
+     *  accumulator is only touched on this core, where energyPayload() reads it.
+     *  Its NVS writes stay away from the RX windows: during a TX/RX the readings
+     *  wait in the queue (METER_QUEUE_SIZE samples).
+     */
+    while (!(LMIC.opmode & OP_TXRXPEND) && meterQueue.pop(&meterReading))
+    {
+        #ifdef USE_ENERGY_ACCUMULATOR
+        if (meterReading.valid)
+        {
+            energyUpdate(meterReading.energy);
+        }
+        #endif
+        
+        #ifdef USE_EVENT_DETECTION
+        eventsSample(&meterReading);
+        #endif
+    }
+    
+    #ifdef USE_EVENT_DETECTION
+    if (eventsPending)
+    {
+        do_send_event(&sendjob);
+    }
+    #endif
+#else
+    /* 
+     *  The Modbus read blocks for a few ms, keep it away from the RX windows.
+     */
+    if (!(LMIC.opmode & OP_TXRXPEND))
+    {
+        meterRead(&meterReading);
+        
+        #ifdef USE_ENERGY_ACCUMULATOR
+        if (meterReading.valid)
+        {
+            energyUpdate(meterReading.energy);
+        }
+        #endif
+        
+        #ifdef USE_EVENT_DETECTION
+        eventsSample(&meterReading);
+        if (eventsPending)
+        {
+            do_send_event(&sendjob);
+        }
+        #endif
+    }
+#endif
+    
+    /* Reschedule sample job */
+    os_setTimedCallback(job, os_getTime() + ms2osticks(METER_SAMPLE_INTERVAL_MS), samplefunc);
+}
+#endif
+
 /*****************************
  _____      _               
 /  ___|    | |              
@@ -441,12 +707,22 @@ void setup()
     DEBUG_PORT.begin(SERIAL_BAUD_RATE);
 #endif
 
+#ifdef USE_DUAL_CORE
+    /* Log task, DEBUG_PORT only queues lines from here on */
+    dualCoreBegin();
+#endif
+
     #ifdef DEBUG
     DEBUG_PORT.println(F("Starting"));
     #endif
     
     pinMode(LED, OUTPUT);
     
+#ifdef AES_SELF_TEST
+    /* Known-answer tests and timings of the AES backends */
+    showAesInformations();
+#endif
+    
 #ifdef VCC_ENABLE
     /* For Pinoccio Scout boards */
     pinMode(VCC_ENABLE, OUTPUT);
@@ -454,6 +730,35 @@ void setup()
     delay(1000);
 #endif
     
+#ifdef USE_CREDENTIALS_STORE
+    /* Keys from NVS/EEPROM, a new record can be provisioned over DEBUG_PORT now */
+    credentialsLoad();
+    credentialsProvisioning(CREDENTIALS_PROVISIONING_WINDOW_MS);
+    
+    #ifdef DEBUG
+    if (credentialsValid)
+    {
+        DEBUG_PORT.println(" [INFO] Credentials profile : " + String(credentialsRecord.activeProfile) + " of " + String(credentialsRecord.profileCount));
+    }
+    else
+    {
+        DEBUG_PORT.println(F(" [INFO] Credentials profile : compile-time (_credentials.h)"));
+    }
+    #endif
+#endif
+    
+    #ifdef USE_PROFILER
+    profilerReset();
+    #endif
+    
+    #ifdef USE_SUPERVISOR
+    /* Recovery context of the previous run and loop watchdog */
+    supervisorBegin();
+    #endif
+    
+    /* Network profile used on boot */
+    networkBegin();
+    
     /* LMIC init */
     os_init();
     
@@ -466,25 +771,12 @@ void setup()
  *  Set static session parameters. Instead of dynamically establishing a session
  *  by joining the network, precomputed session parameters are be provided. 
  */
-#ifdef PROGMEM
-    /*
-     *  On AVR, these values are stored in flash and only copied to RAM once.
-     *  Copy them to a temporary buffer here, LMIC_setSession will.
-     *  Copy them into a buffer of its own again.
-     */
-    uint8_t appskey[sizeof(APPSKEY)];
-    uint8_t nwkskey[sizeof(NWKSKEY)];
-    memcpy_P(appskey, APPSKEY, sizeof(APPSKEY));
-    memcpy_P(nwkskey, NWKSKEY, sizeof(NWKSKEY));
-    LMIC_setSession(0x1, DEVADDR, nwkskey, appskey);
-#else
-    /* If not running an AVR with PROGMEM, just use the arrays directly */
-    LMIC_setSession(0x1, DEVADDR, NWKSKEY, APPSKEY);
-#endif
+    /* Keys of the current network profile or of the credentials store */
+    networkSetSession();
     
     /* Downlink datarate */
     /* The Things Networks uses SF9 for its RX2 window */
-    LMIC.dn2Dr = DN2DR;
+    LMIC.dn2Dr = networkProfile.dn2Dr;
     
     LMIC_setAdrMode(ADR_MODE);
     
@@ -509,7 +801,7 @@ void setup()
 
 /* Over-the-Air Activation (OTAA) */
 #ifdef USE_OTAA
-#ifdef USE_FORCE_OTAA
+#if defined(USE_FORCE_OTAA) && !defined(USE_JOIN_SCHEDULER)
     /* Setando para iniciar rapidamento o Join OTAA, não entrará no EV_JOINING */
     LMIC_startJoining();
     LMIC.txChnl = USE_CHANNEL_START_JOINING;
@@ -524,8 +816,32 @@ void setup()
      */    
 #endif
 
+#ifdef USE_ENERGY_ACCUMULATOR
+    /* Energy total from RTC memory or NVS/EEPROM */
+    energyBegin();
+#endif
+    
+#ifdef USE_METER
+#ifdef USE_DUAL_CORE
+    xTaskCreatePinnedToCore(metertask, "meter", DUAL_CORE_WORKER_STACK, NULL, 1, NULL, DUAL_CORE_WORKER_CORE);
+#endif
+    /* Start sampling the meter */
+    samplefunc(&samplejob);
+#endif
+    
+#if defined(USE_OTAA) && defined(USE_JOIN_SCHEDULER)
+    /* First join round at a random time, so a fleet powered up together spreads out */
+    joinBegin();
+    os_setTimedCallback(&joinjob, os_getTime() + ms2osticks(joinInitialDelayMs()), joinfunc);
+#else
     /* When you get here go to EV */
     do_send(&sendjob);
+#endif
+
+#ifdef USE_DUAL_CORE
+    /* From here on only lmictask() touches LMiC */
+    xTaskCreatePinnedToCore(lmictask, "lmic", DUAL_CORE_LMIC_STACK, NULL, DUAL_CORE_LMIC_PRIORITY, NULL, DUAL_CORE_LMIC_CORE);
+#endif
 }
 
 /*****************************
@@ -539,8 +855,65 @@ void setup()
                   |_|    
 *****************************/
 
-void loop()
+/* One pass of the run loop, from loop() or from lmictask() */
+void runloop()
 {
     /* Loop once only */
-    os_runloop_once();
+    {
+        PROFILE_SCOPE(PROFILER_RUNLOOP);
+        os_runloop_once();
+    }
+    
+    #ifdef USE_PROFILER
+    /* Profile on demand */
+    if (DEBUG_PORT.available() && DEBUG_PORT.read() == PROFILER_DUMP_KEY)
+    {
+        profilerDump();
+    }
+    #endif
+    
+    #ifdef USE_SUPERVISOR
+    u1_t level = supervisorCheck(millis());
+    if (level != 0)
+    {
+        supervisorRecover(level);
+    }
+    #endif
+}
+
+#ifdef USE_DUAL_CORE
+/* LMiC alone on its core, highest priority there */
+void lmictask(void *parameter)
+{
+    #ifdef USE_SUPERVISOR
+    supervisorWatchTask();
+    #endif
+    
+    for (;;)
+    {
+        runloop();
+        
+        /* 
+         *  DIO lines are polled: TX done, RX done and the RX window jobs are only
+         *  seen when os_runloop_once() runs, so a tick of sleep is up to a tick
+         *  of error on them. Poll without pause while a TX/RX is pending (a few
+         *  seconds at most, the core has no other task), otherwise give the
+         *  idle task one tick.
+         */
+        if (!(LMIC.opmode & OP_TXRXPEND))
+        {
+            vTaskDelay(1);
+        }
+    }
+}
+#endif
+
+void loop()
+{
+#ifdef USE_DUAL_CORE
+    /* Everything runs in the tasks started by setup() */
+    vTaskDelete(NULL);
+#else
+    runloop();
+#endif
 }
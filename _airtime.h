@@ -0,0 +1,92 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+#pragma once
+
+/* Includes */
+#include <lmic.h>
+
+/*
+ *  LoRa time on air (Semtech AN1200.13), explicit header, CRC on, CR 4/5,
+ *  8 symbols preamble. AU915 uplinks: DR0..DR5 = SF12..SF7 BW125, DR6 = SF8 BW500.
+ *  Same numbers as the Airtime calculator listed in _useful.ino.
+ */
+
+/* Definitions */
+#define LORAWAN_OVERHEAD            13      /* MHDR (1) + FHDR (7) + FPort (1) + MIC (4) */
+
+/* Functions */
+/* phyLen: whole PHY payload, e.g. LORAWAN_OVERHEAD + application bytes, 23 for a join request */
+u4_t airtimeUs(u1_t dr, u1_t phyLen)
+{
+    u1_t sf;
+    u4_t symbolUs;
+
+    if (dr == 6)
+    {
+        sf       = 8;
+        symbolUs = (1UL << sf) * 2;     /* BW500: 2 us per chip */
+    }
+    else
+    {
+        sf       = 12 - (dr > 5 ? 5 : dr);
+        symbolUs = (1UL << sf) * 8;     /* BW125: 8 us per chip */
+    }
+
+    /* Low data rate optimization when a symbol lasts 16 ms or more */
+    u1_t de  = (symbolUs >= 16000) ? 1 : 0;
+    s4_t num = 8 * (s4_t)phyLen - 4 * sf + 28 + 16;
+    s4_t den = 4 * (sf - 2 * de);
+    u4_t payloadSymbols = 8 + (num > 0 ? (u4_t)((num + den - 1) / den) * 5 : 0);
+
+    /* (8 + 4.25 + payloadSymbols) symbols, kept in quarters of symbol */
+    return (49 + 4 * payloadSymbols) * symbolUs / 4;
+}
+
+u4_t airtimeMs(u1_t dr, u1_t phyLen)
+{
+    return (airtimeUs(dr, phyLen) + 999) / 1000;
+}
@@ -70,11 +70,21 @@
 //#define SINGLE_CHANNEL            8
 /* Observe the Data Rate (Spreading Factor) in #define DATA_RATE */
 
-// Only one of these settings must be defined
-#define USE_CHIRPSTACK_AU915          /* AU915    (8 at 15 + 65 channels) */
-//#define USE_CHIRPSTACK_AU915LA        /* AU915LA  (0 at 7 + 64 channels) */
-//#define USE_EVERYNET_AU915LA          /* AU915LA  (0 at 7 channels) */
-//#define USE_THETHINGSNETWORK_AU915    /* AU915    (8 at 15 + 65 channels) */
+/* Networks, every one of them is built into the image (see _network_profiles.h) */
+#define NETWORK_CHIRPSTACK_AU915        0   /* AU915    (8 at 15 + 65 channels) */
+#define NETWORK_CHIRPSTACK_AU915LA      1   /* AU915LA  (0 at 7 + 64 channels) */
+#define NETWORK_EVERYNET_AU915LA        2   /* AU915LA  (0 at 7 channels) */
+#define NETWORK_THETHINGSNETWORK_AU915  3   /* AU915    (8 at 15 + 65 channels) */
+#define NETWORKS_COUNT                  4
+
+/* Network used on boot and the one to fail over to after repeated EV_JOIN_FAILED (OTAA) */
+#define NETWORK_PRIMARY                 NETWORK_CHIRPSTACK_AU915
+#define NETWORK_BACKUP                  NETWORK_THETHINGSNETWORK_AU915
+#define NETWORK_FAILOVER_JOIN_FAILURES  3   /* 0 = never fail over */
+
+/* Keys provisioned at runtime in NVS/EEPROM (see _credentials_store.h), the networks above are the fallback */
+//#define USE_CREDENTIALS_STORE
+#define CREDENTIALS_PROVISIONING_WINDOW_MS  2000    /* Time waiting for a "CRED" record on boot */
 
 /* 
  *  LoRa SPI
@@ -111,10 +121,84 @@
  */
 #define UPLINK_DATA_RATE            DR_SF7  /* Spreading Factor Uplinks */
 #define TRANSMIT_POWER              14      /* Power Uplinks */
-#define DN2DR                       DR_SF9  /* The Things Networks uses SF9 for its RX2 window */
-#define RX_DELAY                    1       /* Set the delay for the first RX window in seconds, Default 1 */
+#define DN2DR                       DR_SF9  /* The Things Networks uses SF9 for its RX2 window, default of every network profile */
+#define RX_DELAY                    1       /* Set the delay for the first RX window in seconds, Default 1, default of every network profile */
 #define CLOCK_ERROR                 1       /* Let LMIC compensate for +/- n% clock error */
 
+/* Energy meter PZEM-004T 3.0 (see _meter.h) */
+//#define USE_METER
+#define PZEM_SERIAL                 Serial2
+#define PZEM_RX_GPIO                16
+#define PZEM_TX_GPIO                17
+#define METER_SAMPLE_INTERVAL_MS    1000    /* Sampling period, also the event detection step */
+
+/* Event detection with priority uplinks (see _events.h), requires USE_METER */
+//#define USE_EVENT_DETECTION
+#define EVENTS_UPLINK_PORT          102     /* Port of the event uplinks */
+#define EVENTS_NOMINAL_VOLTAGE      2200    /* 0.1 V */
+#define EVENTS_OUTAGE_VOLTAGE       500     /* 0.1 V, below this it is an outage */
+#define EVENTS_OVERVOLTAGE          2530    /* 0.1 V, instantaneous */
+#define EVENTS_SAG_SWELL_PERCENT    10      /* Band around the nominal voltage */
+#define EVENTS_SAG_SWELL_SAMPLES    3       /* Consecutive samples outside the band */
+#define EVENTS_POWER_STEP           10000   /* 0.1 W between two samples */
+#define EVENTS_AIRTIME_BUDGET_MS    30000   /* Airtime per hour for event uplinks */
+
+/* Energy accumulator with delta encoded uplinks (see _energy.h), requires USE_METER */
+//#define USE_ENERGY_ACCUMULATOR
+#define ENERGY_UPLINK_PORT          103     /* Port of the energy uplinks, replaces the UPLINK_PORT payload */
+#define ENERGY_METER_WRAP_WH        10000000UL  /* PZEM-004T counts up to 9999.999 kWh */
+#define ENERGY_PERSIST_STEP_WH      100     /* NVS/EEPROM write every n Wh */
+#define ENERGY_ANCHOR_INTERVAL      24      /* Delta frames between two absolute anchors */
+#define ENERGY_EEPROM_ADDRESS       384     /* Not ESP32: after the credentials record */
+
+/* Firmware update over fragmented downlinks (see _fuota.h), ESP32 with an OTA partition table */
+//#define USE_FUOTA
+#define FUOTA_PORT                  201
+#define FUOTA_MAX_FRAGMENT_SIZE     48      /* Fits AU915 DR8 downlinks with the 3 byte header */
+#define FUOTA_MAX_FRAGMENTS         32768
+#define FUOTA_MAX_MISSING           256     /* Lost fragments the FEC can rebuild, fuotaBuffers_t takes 25.6 KB (25600 bytes) of RAM during a session */
+#define FUOTA_WORK_RETRY_MS         500     /* Flash work waits for the end of TX/RX */
+
+/* Watchdog and fault recovery (see _supervisor.h) */
+//#define USE_SUPERVISOR
+#define SUPERVISOR_PORT             104
+#define SUPERVISOR_TXRX_DEADLINE_MS 30000   /* OP_TXRXPEND longer than this is a stuck radio */
+#define SUPERVISOR_MISSED_INTERVALS 4       /* TX_INTERVALs without EV_TXCOMPLETE before escalating */
+#define SUPERVISOR_LOOP_TIMEOUT_S   30      /* ESP32 task watchdog on loop() */
+
+/* Join scheduler: random start, backoff and airtime budget for OTAA joins (see _join.h) */
+//#define USE_JOIN_SCHEDULER
+#define JOIN_INITIAL_WINDOW_MS      60000   /* First join round at a random time within this window */
+#define JOIN_ATTEMPTS_PER_ROUND     3       /* Join requests without answer before backing off */
+#define JOIN_BACKOFF_BASE_MS        30000   /* Doubles every failed round */
+#define JOIN_BACKOFF_MAX_MS         3600000 /* 1 h, keeps ms2osticks() in range */
+#define JOIN_DR_FASTEST             5       /* First round: DR5 (SF7BW125) */
+#define JOIN_DR_SLOWEST             2       /* Last step: DR2 (SF10BW125), max 400 ms dwell time */
+#define JOIN_AIRTIME_BUDGET_MS      36000   /* Join airtime per hour (1%) */
+
+/* Profiling hooks, flat profile dumped on DEBUG_PORT (see _profiler.h) */
+//#define USE_PROFILER
+#define PROFILER_DUMP_KEY           'P'     /* Serial character that prints and restarts the profile */
+
+/* ESP32 dual core: LMiC task on one core, meter and serial log tasks on the other (see _dual_core.h) */
+//#define USE_DUAL_CORE
+#define DUAL_CORE_LMIC_CORE         1       /* Core of the Arduino loop() */
+#define DUAL_CORE_WORKER_CORE       0
+#define DUAL_CORE_LMIC_PRIORITY     (configMAX_PRIORITIES - 2)
+#define DUAL_CORE_LMIC_STACK        8192
+#define DUAL_CORE_WORKER_STACK      4096
+#define DUAL_CORE_LOG_LINE          128     /* Longer log lines are cut */
+#define DUAL_CORE_LOG_QUEUE         64      /* Lines per producer task, power of two */
+#define DUAL_CORE_LOG_PRODUCERS     3       /* Tasks that log: loop() task (setup), lmictask, metertask */
+#define DUAL_CORE_LOG_PERIOD_MS     10
+#define METER_QUEUE_SIZE            8       /* Readings, power of two */
+
+/* Cryptography (see _crypto.h) */
+/* AES backend: AES_BACKEND_REFERENCE, AES_BACKEND_TABLE or AES_BACKEND_HARDWARE (ESP32), default by board */
+//#define AES_BACKEND                 AES_BACKEND_TABLE
+//#define USE_LMIC_AES_HOOK                   /* LMiC os_aes() uses the backend above, needs tools/lmic_aes_hook.sh */
+//#define AES_SELF_TEST                       /* Known-answer tests and AES timings on boot */
+
 /* Others definitions */
 #define LED                         25
 
@@ -0,0 +1,271 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+#pragma once
+
+/* Includes */
+#include <lmic.h>
+#if defined(ARDUINO_ARCH_ESP32)
+#include <Preferences.h>    /* NVS */
+#else
+#include <EEPROM.h>
+#endif
+
+/*
+ *  Credentials Store
+ *  
+ *  One firmware image for the whole fleet: instead of the compile-time
+ *  tables of _credentials.h, the keys are read from a binary record kept
+ *  in NVS (ESP32) or EEPROM. The record holds up to CREDENTIALS_MAX_PROFILES
+ *  network profiles and the index of the active one.
+ *  
+ *  While the record is empty or invalid the tables of _credentials.h are
+ *  used, exactly as before. The keys are handed to LMiC by _network_profiles.h.
+ *  
+ *  Provisioning (one shot, over DEBUG_PORT during the first seconds after reset):
+ *  send "CRED" followed by the sizeof(credentialsRecord_t) bytes of the record,
+ *  the node answers " [INFO] Credentials provisioned" and goes on booting.
+ *  
+ *  Record layout (every field is a byte array, so there is no padding):
+ *  | magic "LW" (2) | version (1) | active profile (1) | profile count (1) |
+ *  | profiles (CREDENTIALS_MAX_PROFILES x 69) | CRC-16/CCITT-FALSE, MSB first (2) |
+ *  
+ *  Profile layout:
+ *  | network (1) | AppEUI (8) | DevEUI (8) | AppKey (16) | DevAddr, MSB first (4) | NwkSKey (16) | AppSKey (16) |
+ *  EUIs and keys use the same byte order as the arrays in _credentials.h.
+ */
+
+/* Definitions */
+#define CREDENTIALS_VERSION             1
+#define CREDENTIALS_MAX_PROFILES        4
+#define CREDENTIALS_SERIAL_HEADER       "CRED"
+#define CREDENTIALS_NVS_NAMESPACE       "lorawan"
+#define CREDENTIALS_NVS_KEY             "credentials"
+#define CREDENTIALS_EEPROM_ADDRESS      0
+
+/* Types */
+typedef struct
+{
+    u1_t network;           /* NETWORK_* (see _configurations.h), selects the row of networkProfiles[] */
+    /* Over-the-Air Activation (OTAA) */
+    u1_t appEui[8];
+    u1_t devEui[8];
+    u1_t appKey[16];
+    /* Activation by Personalization (ABP) */
+    u1_t devAddr[4];
+    u1_t nwkSKey[16];
+    u1_t appSKey[16];
+} credentialsProfile_t;
+
+typedef struct
+{
+    u1_t magic[2];
+    u1_t version;
+    u1_t activeProfile;
+    u1_t profileCount;
+    credentialsProfile_t profiles[CREDENTIALS_MAX_PROFILES];
+    u1_t crc[2];
+} credentialsRecord_t;
+
+/* Variables */
+credentialsRecord_t credentialsRecord;
+bool                credentialsValid = false;
+u1_t                credentialsStoredProfile = 0;   /* activeProfile in flash, the RAM copy may be a failover */
+
+/* Functions */
+/* CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) */
+u2_t credentialsCrc(const u1_t *data, u2_t len)
+{
+    u2_t crc = 0xFFFF;
+
+    for (u2_t i = 0; i < len; i++)
+    {
+        crc ^= (u2_t)data[i] << 8;
+        for (u1_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (u2_t)((crc << 1) ^ 0x1021) : (u2_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+bool credentialsCheck(const credentialsRecord_t *record)
+{
+    u2_t crc = credentialsCrc((const u1_t *)record, sizeof(credentialsRecord_t) - 2);
+
+    if (record->magic[0] != 'L'
+        || record->magic[1] != 'W'
+        || record->version != CREDENTIALS_VERSION
+        || record->profileCount == 0
+        || record->profileCount > CREDENTIALS_MAX_PROFILES
+        || record->activeProfile >= record->profileCount
+        || record->crc[0] != (u1_t)(crc >> 8)
+        || record->crc[1] != (u1_t)(crc))
+    {
+        return false;
+    }
+
+    for (u1_t i = 0; i < record->profileCount; i++)
+    {
+        if (record->profiles[i].network >= NETWORKS_COUNT)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void credentialsLoad()
+{
+#if defined(ARDUINO_ARCH_ESP32)
+    Preferences preferences;
+    preferences.begin(CREDENTIALS_NVS_NAMESPACE, true);
+    size_t size = preferences.getBytes(CREDENTIALS_NVS_KEY, &credentialsRecord, sizeof(credentialsRecord));
+    preferences.end();
+    credentialsValid = (size == sizeof(credentialsRecord)) && credentialsCheck(&credentialsRecord);
+#else
+    #if defined(ESP8266)
+    EEPROM.begin(CREDENTIALS_EEPROM_ADDRESS + sizeof(credentialsRecord));
+    #endif
+    EEPROM.get(CREDENTIALS_EEPROM_ADDRESS, credentialsRecord);
+    credentialsValid = credentialsCheck(&credentialsRecord);
+#endif
+    credentialsStoredProfile = credentialsRecord.activeProfile;
+}
+
+bool credentialsSave()
+{
+    u2_t crc = credentialsCrc((const u1_t *)&credentialsRecord, sizeof(credentialsRecord) - 2);
+    credentialsRecord.crc[0] = (u1_t)(crc >> 8);
+    credentialsRecord.crc[1] = (u1_t)(crc);
+
+    if (!credentialsCheck(&credentialsRecord))
+    {
+        return false;
+    }
+
+#if defined(ARDUINO_ARCH_ESP32)
+    Preferences preferences;
+    preferences.begin(CREDENTIALS_NVS_NAMESPACE, false);
+    size_t size = preferences.putBytes(CREDENTIALS_NVS_KEY, &credentialsRecord, sizeof(credentialsRecord));
+    preferences.end();
+    credentialsValid = (size == sizeof(credentialsRecord));
+#else
+    EEPROM.put(CREDENTIALS_EEPROM_ADDRESS, credentialsRecord);
+    #if defined(ESP8266)
+    EEPROM.commit();
+    #endif
+    credentialsValid = true;
+#endif
+    if (credentialsValid)
+    {
+        credentialsStoredProfile = credentialsRecord.activeProfile;
+    }
+    return credentialsValid;
+}
+
+/* Active profile, NULL when the compile-time tables of _credentials.h are in use */
+const credentialsProfile_t *credentialsProfile()
+{
+    return credentialsValid ? &credentialsRecord.profiles[credentialsRecord.activeProfile] : NULL;
+}
+
+/*
+ *  Returns false if the index does not exist or the profile is already the stored one.
+ *  Compared with the stored profile, not with activeProfile, which a join failover
+ *  (networkJoinFailed) may have moved in RAM only.
+ */
+bool credentialsSelectProfile(u1_t index)
+{
+    if (!credentialsValid || index >= credentialsRecord.profileCount || index == credentialsStoredProfile)
+    {
+        return false;
+    }
+
+    credentialsRecord.activeProfile = index;
+    return credentialsSave();
+}
+
+/*
+ *  Waits windowMs for the "CRED" header on DEBUG_PORT and then reads the whole record.
+ *  The record is only stored if its CRC and fields are valid.
+ */
+void credentialsProvisioning(unsigned long windowMs)
+{
+    const char   *header  = CREDENTIALS_SERIAL_HEADER;
+    u1_t          matched = 0;
+    unsigned long start   = millis();
+
+    while (millis() - start < windowMs)
+    {
+        if (!DEBUG_PORT.available())
+        {
+            continue;
+        }
+
+        char c  = DEBUG_PORT.read();
+        matched = (c == header[matched]) ? matched + 1 : (c == header[0] ? 1 : 0);
+
+        if (matched == strlen(header))
+        {
+            credentialsRecord_t record;
+            DEBUG_PORT.setTimeout(1000);
+            size_t size = DEBUG_PORT.readBytes((u1_t *)&record, sizeof(record));
+
+            if (size == sizeof(record) && credentialsCheck(&record))
+            {
+                memcpy(&credentialsRecord, &record, sizeof(record));
+                if (credentialsSave())
+                {
+                    DEBUG_PORT.println(F(" [INFO] Credentials provisioned"));
+                    return;
+                }
+            }
+            DEBUG_PORT.println(F(" [INFO] Credentials rejected <<< "));
+            return;
+        }
+    }
+}
@@ -0,0 +1,656 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+#pragma once
+
+/* Includes */
+#include <stdint.h>
+#include <string.h>
+
+/*
+ *  AES-128 and AES-CMAC used by LoRaWAN (LoRaWAN 1.0.x, section 6.2 and 4.4).
+ *  This file has no Arduino or LMiC dependencies, so the same code runs
+ *  on the node and on a host build (see _network_server.h).
+ *
+ *  Key and block buffers are always 16 bytes, in the same byte order
+ *  used by the frames and by the APPKEY/NWKSKEY/APPSKEY arrays. Every
+ *  function and table is static, so several translation units of a host
+ *  build can include this header (see tests/).
+ *
+ *  The forward cipher has three interchangeable backends, selected with
+ *  AES_BACKEND (see _configurations.h):
+ *
+ *  AES_BACKEND_REFERENCE:  byte oriented, no tables in RAM (default on AVR).
+ *  AES_BACKEND_TABLE:      32 bits T-table with cached key schedule, 1 KB of RAM.
+ *  AES_BACKEND_HARDWARE:   ESP32 AES engine through mbedTLS (default on ESP32).
+ *
+ *  LMiC does its own crypto with the Ideetron AES. With USE_LMIC_AES_HOOK
+ *  the selected backend is also exported as lmic_aes_encrypt(), the block
+ *  function called by LMiC's os_aes() (src/aes/other.c). The library has no
+ *  switch to drop its own lmic_aes_encrypt(), so it has to be patched once
+ *  with tools/lmic_aes_hook.sh, which defines LMIC_AES_EXTERNAL in
+ *  lmic_project_config.h. Without the hook only this file (self test, host
+ *  network server) uses the ESP32 AES engine.
+ */
+
+/* Definitions */
+#define AES_BLOCK_SIZE              16
+#define AES_ROUNDS                  10
+#define AES_EXPANDED_KEY_SIZE       176     /* (AES_ROUNDS + 1) * AES_BLOCK_SIZE */
+
+#define AES_BACKEND_REFERENCE       0
+#define AES_BACKEND_TABLE           1
+#define AES_BACKEND_HARDWARE        2
+
+#ifndef AES_BACKEND
+#if defined(ARDUINO_ARCH_ESP32)
+#define AES_BACKEND                 AES_BACKEND_HARDWARE
+#elif defined(__AVR__)
+#define AES_BACKEND                 AES_BACKEND_REFERENCE
+#else
+#define AES_BACKEND                 AES_BACKEND_TABLE
+#endif
+#endif
+
+#if AES_BACKEND == AES_BACKEND_HARDWARE
+#include "mbedtls/aes.h"            /* Mapped to the AES peripheral by ESP-IDF (MBEDTLS_AES_ALT) */
+#endif
+
+/* Forward S-box */
+static const uint8_t aesSbox[256] = {
+    0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5, 0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
+    0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0, 0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
+    0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC, 0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
+    0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A, 0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
+    0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0, 0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
+    0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B, 0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
+    0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85, 0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
+    0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5, 0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
+    0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17, 0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
+    0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88, 0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
+    0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C, 0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
+    0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9, 0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
+    0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6, 0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
+    0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E, 0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
+    0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94, 0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
+    0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68, 0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16
+};
+
+/* Inverse S-box, only needed by the network side (join accept encryption) */
+static const uint8_t aesInvSbox[256] = {
+    0x52, 0x09, 0x6A, 0xD5, 0x30, 0x36, 0xA5, 0x38, 0xBF, 0x40, 0xA3, 0x9E, 0x81, 0xF3, 0xD7, 0xFB,
+    0x7C, 0xE3, 0x39, 0x82, 0x9B, 0x2F, 0xFF, 0x87, 0x34, 0x8E, 0x43, 0x44, 0xC4, 0xDE, 0xE9, 0xCB,
+    0x54, 0x7B, 0x94, 0x32, 0xA6, 0xC2, 0x23, 0x3D, 0xEE, 0x4C, 0x95, 0x0B, 0x42, 0xFA, 0xC3, 0x4E,
+    0x08, 0x2E, 0xA1, 0x66, 0x28, 0xD9, 0x24, 0xB2, 0x76, 0x5B, 0xA2, 0x49, 0x6D, 0x8B, 0xD1, 0x25,
+    0x72, 0xF8, 0xF6, 0x64, 0x86, 0x68, 0x98, 0x16, 0xD4, 0xA4, 0x5C, 0xCC, 0x5D, 0x65, 0xB6, 0x92,
+    0x6C, 0x70, 0x48, 0x50, 0xFD, 0xED, 0xB9, 0xDA, 0x5E, 0x15, 0x46, 0x57, 0xA7, 0x8D, 0x9D, 0x84,
+    0x90, 0xD8, 0xAB, 0x00, 0x8C, 0xBC, 0xD3, 0x0A, 0xF7, 0xE4, 0x58, 0x05, 0xB8, 0xB3, 0x45, 0x06,
+    0xD0, 0x2C, 0x1E, 0x8F, 0xCA, 0x3F, 0x0F, 0x02, 0xC1, 0xAF, 0xBD, 0x03, 0x01, 0x13, 0x8A, 0x6B,
+    0x3A, 0x91, 0x11, 0x41, 0x4F, 0x67, 0xDC, 0xEA, 0x97, 0xF2, 0xCF, 0xCE, 0xF0, 0xB4, 0xE6, 0x73,
+    0x96, 0xAC, 0x74, 0x22, 0xE7, 0xAD, 0x35, 0x85, 0xE2, 0xF9, 0x37, 0xE8, 0x1C, 0x75, 0xDF, 0x6E,
+    0x47, 0xF1, 0x1A, 0x71, 0x1D, 0x29, 0xC5, 0x89, 0x6F, 0xB7, 0x62, 0x0E, 0xAA, 0x18, 0xBE, 0x1B,
+    0xFC, 0x56, 0x3E, 0x4B, 0xC6, 0xD2, 0x79, 0x20, 0x9A, 0xDB, 0xC0, 0xFE, 0x78, 0xCD, 0x5A, 0xF4,
+    0x1F, 0xDD, 0xA8, 0x33, 0x88, 0x07, 0xC7, 0x31, 0xB1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xEC, 0x5F,
+    0x60, 0x51, 0x7F, 0xA9, 0x19, 0xB5, 0x4A, 0x0D, 0x2D, 0xE5, 0x7A, 0x9F, 0x93, 0xC9, 0x9C, 0xEF,
+    0xA0, 0xE0, 0x3B, 0x4D, 0xAE, 0x2A, 0xF5, 0xB0, 0xC8, 0xEB, 0xBB, 0x3C, 0x83, 0x53, 0x99, 0x61,
+    0x17, 0x2B, 0x04, 0x7E, 0xBA, 0x77, 0xD6, 0x26, 0xE1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0C, 0x7D
+};
+
+/* Functions */
+static inline uint8_t aesXtime(uint8_t x)
+{
+    return (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1B : 0x00));
+}
+
+/* Multiplication in GF(2^8), used by InvMixColumns */
+static inline uint8_t aesMul(uint8_t a, uint8_t b)
+{
+    uint8_t result = 0;
+
+    while (b)
+    {
+        if (b & 1)
+        {
+            result ^= a;
+        }
+        a = aesXtime(a);
+        b >>= 1;
+    }
+    return result;
+}
+
+static void aesExpandKey(const uint8_t *key, uint8_t *roundKeys)
+{
+    uint8_t rcon = 0x01;
+
+    memcpy(roundKeys, key, AES_BLOCK_SIZE);
+
+    for (uint8_t i = 4; i < 4 * (AES_ROUNDS + 1); i++)
+    {
+        uint8_t temp[4];
+        memcpy(temp, &roundKeys[(i - 1) * 4], 4);
+
+        if ((i & 3) == 0)
+        {
+            /* RotWord + SubWord + Rcon */
+            uint8_t first = temp[0];
+            temp[0] = aesSbox[temp[1]] ^ rcon;
+            temp[1] = aesSbox[temp[2]];
+            temp[2] = aesSbox[temp[3]];
+            temp[3] = aesSbox[first];
+            rcon = aesXtime(rcon);
+        }
+
+        for (uint8_t j = 0; j < 4; j++)
+        {
+            roundKeys[i * 4 + j] = roundKeys[(i - 4) * 4 + j] ^ temp[j];
+        }
+    }
+}
+
+/* Byte oriented reference implementation (FIPS-197), small and slow */
+static void aesReferenceEncryptBlock(const uint8_t *key, const uint8_t *in, uint8_t *out)
+{
+    uint8_t roundKeys[AES_EXPANDED_KEY_SIZE];
+    uint8_t state[AES_BLOCK_SIZE];
+
+    aesExpandKey(key, roundKeys);
+
+    for (uint8_t i = 0; i < AES_BLOCK_SIZE; i++)
+    {
+        state[i] = in[i] ^ roundKeys[i];
+    }
+
+    for (uint8_t round = 1; round <= AES_ROUNDS; round++)
+    {
+        uint8_t temp[AES_BLOCK_SIZE];
+
+        /* SubBytes + ShiftRows */
+        for (uint8_t i = 0; i < AES_BLOCK_SIZE; i++)
+        {
+            temp[i] = aesSbox[state[(i + 4 * (i & 3)) & 15]];
+        }
+
+        /* MixColumns (skipped in the last round) */
+        if (round != AES_ROUNDS)
+        {
+            for (uint8_t c = 0; c < AES_BLOCK_SIZE; c += 4)
+            {
+                uint8_t a0 = temp[c], a1 = temp[c + 1], a2 = temp[c + 2], a3 = temp[c + 3];
+                uint8_t all = a0 ^ a1 ^ a2 ^ a3;
+                temp[c]     ^= all ^ aesXtime(a0 ^ a1);
+                temp[c + 1] ^= all ^ aesXtime(a1 ^ a2);
+                temp[c + 2] ^= all ^ aesXtime(a2 ^ a3);
+                temp[c + 3] ^= all ^ aesXtime(a3 ^ a0);
+            }
+        }
+
+        /* AddRoundKey */
+        for (uint8_t i = 0; i < AES_BLOCK_SIZE; i++)
+        {
+            state[i] = temp[i] ^ roundKeys[round * AES_BLOCK_SIZE + i];
+        }
+    }
+
+    memcpy(out, state, AES_BLOCK_SIZE);
+}
+
+/* Encryption T-table, Te0[x] = { 2.S[x], S[x], S[x], 3.S[x] }, Te1..Te3 are rotations of it */
+static uint32_t aesTe0[256];
+static bool     aesTableReady = false;
+
+/* Last key used, LMiC and the MIC/payload helpers reuse the same key block after block */
+static uint8_t  aesTableKey[AES_BLOCK_SIZE];
+static uint32_t aesTableRoundKeys[4 * (AES_ROUNDS + 1)];
+static bool     aesTableKeyValid = false;
+
+static inline uint32_t aesRotr(uint32_t x, uint8_t n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+static inline uint32_t aesLoad32(const uint8_t *buf)
+{
+    return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | (uint32_t)buf[3];
+}
+
+static inline void aesStore32(uint8_t *buf, uint32_t value)
+{
+    buf[0] = (uint8_t)(value >> 24);
+    buf[1] = (uint8_t)(value >> 16);
+    buf[2] = (uint8_t)(value >> 8);
+    buf[3] = (uint8_t)(value);
+}
+
+static void aesTableInit()
+{
+    for (uint16_t x = 0; x < 256; x++)
+    {
+        uint8_t s  = aesSbox[x];
+        uint8_t s2 = aesXtime(s);
+        aesTe0[x]  = ((uint32_t)s2 << 24) | ((uint32_t)s << 16) | ((uint32_t)s << 8) | (uint32_t)(s2 ^ s);
+    }
+    aesTableReady = true;
+}
+
+static void aesTableSetKey(const uint8_t *key)
+{
+    uint8_t roundKeys[AES_EXPANDED_KEY_SIZE];
+
+    aesExpandKey(key, roundKeys);
+    for (uint8_t i = 0; i < 4 * (AES_ROUNDS + 1); i++)
+    {
+        aesTableRoundKeys[i] = aesLoad32(&roundKeys[i * 4]);
+    }
+    memcpy(aesTableKey, key, AES_BLOCK_SIZE);
+    aesTableKeyValid = true;
+}
+
+/* Table based implementation, one lookup per byte and round */
+static void aesTableEncryptBlock(const uint8_t *key, const uint8_t *in, uint8_t *out)
+{
+    if (!aesTableReady)
+    {
+        aesTableInit();
+    }
+    if (!aesTableKeyValid || memcmp(aesTableKey, key, AES_BLOCK_SIZE) != 0)
+    {
+        aesTableSetKey(key);
+    }
+
+    const uint32_t *rk = aesTableRoundKeys;
+    uint32_t s0 = aesLoad32(&in[0])  ^ rk[0];
+    uint32_t s1 = aesLoad32(&in[4])  ^ rk[1];
+    uint32_t s2 = aesLoad32(&in[8])  ^ rk[2];
+    uint32_t s3 = aesLoad32(&in[12]) ^ rk[3];
+
+    for (uint8_t round = 1; round < AES_ROUNDS; round++)
+    {
+        rk += 4;
+        uint32_t t0 = aesTe0[s0 >> 24] ^ aesRotr(aesTe0[(s1 >> 16) & 0xFF], 8) ^ aesRotr(aesTe0[(s2 >> 8) & 0xFF], 16) ^ aesRotr(aesTe0[s3 & 0xFF], 24) ^ rk[0];
+        uint32_t t1 = aesTe0[s1 >> 24] ^ aesRotr(aesTe0[(s2 >> 16) & 0xFF], 8) ^ aesRotr(aesTe0[(s3 >> 8) & 0xFF], 16) ^ aesRotr(aesTe0[s0 & 0xFF], 24) ^ rk[1];
+        uint32_t t2 = aesTe0[s2 >> 24] ^ aesRotr(aesTe0[(s3 >> 16) & 0xFF], 8) ^ aesRotr(aesTe0[(s0 >> 8) & 0xFF], 16) ^ aesRotr(aesTe0[s1 & 0xFF], 24) ^ rk[2];
+        uint32_t t3 = aesTe0[s3 >> 24] ^ aesRotr(aesTe0[(s0 >> 16) & 0xFF], 8) ^ aesRotr(aesTe0[(s1 >> 8) & 0xFF], 16) ^ aesRotr(aesTe0[s2 & 0xFF], 24) ^ rk[3];
+        s0 = t0;
+        s1 = t1;
+        s2 = t2;
+        s3 = t3;
+    }
+
+    /* Last round: SubBytes + ShiftRows + AddRoundKey */
+    rk += 4;
+    aesStore32(&out[0],  (((uint32_t)aesSbox[s0 >> 24] << 24) | ((uint32_t)aesSbox[(s1 >> 16) & 0xFF] << 16) | ((uint32_t)aesSbox[(s2 >> 8) & 0xFF] << 8) | aesSbox[s3 & 0xFF]) ^ rk[0]);
+    aesStore32(&out[4],  (((uint32_t)aesSbox[s1 >> 24] << 24) | ((uint32_t)aesSbox[(s2 >> 16) & 0xFF] << 16) | ((uint32_t)aesSbox[(s3 >> 8) & 0xFF] << 8) | aesSbox[s0 & 0xFF]) ^ rk[1]);
+    aesStore32(&out[8],  (((uint32_t)aesSbox[s2 >> 24] << 24) | ((uint32_t)aesSbox[(s3 >> 16) & 0xFF] << 16) | ((uint32_t)aesSbox[(s0 >> 8) & 0xFF] << 8) | aesSbox[s1 & 0xFF]) ^ rk[2]);
+    aesStore32(&out[12], (((uint32_t)aesSbox[s3 >> 24] << 24) | ((uint32_t)aesSbox[(s0 >> 16) & 0xFF] << 16) | ((uint32_t)aesSbox[(s1 >> 8) & 0xFF] << 8) | aesSbox[s2 & 0xFF]) ^ rk[3]);
+}
+
+#if AES_BACKEND == AES_BACKEND_HARDWARE
+/* ESP32 AES engine, the key is only loaded again when it changes */
+static mbedtls_aes_context aesHardwareContext;
+static uint8_t             aesHardwareKey[AES_BLOCK_SIZE];
+static bool                aesHardwareKeyValid = false;
+
+static void aesHardwareEncryptBlock(const uint8_t *key, const uint8_t *in, uint8_t *out)
+{
+    if (!aesHardwareKeyValid || memcmp(aesHardwareKey, key, AES_BLOCK_SIZE) != 0)
+    {
+        if (!aesHardwareKeyValid)
+        {
+            mbedtls_aes_init(&aesHardwareContext);
+        }
+        mbedtls_aes_setkey_enc(&aesHardwareContext, key, 128);
+        memcpy(aesHardwareKey, key, AES_BLOCK_SIZE);
+        aesHardwareKeyValid = true;
+    }
+    mbedtls_aes_crypt_ecb(&aesHardwareContext, MBEDTLS_AES_ENCRYPT, in, out);
+}
+#endif
+
+/* Forward cipher through the selected backend, in and out may overlap */
+static void aesEncryptBlock(const uint8_t *key, const uint8_t *in, uint8_t *out)
+{
+#if AES_BACKEND == AES_BACKEND_HARDWARE
+    aesHardwareEncryptBlock(key, in, out);
+#elif AES_BACKEND == AES_BACKEND_TABLE
+    aesTableEncryptBlock(key, in, out);
+#else
+    aesReferenceEncryptBlock(key, in, out);
+#endif
+}
+
+/*
+ *  Inverse cipher. The node never needs it, LoRaWAN has the network server
+ *  "decrypt" the join accept so the node only ever runs the forward cipher.
+ */
+static void aesDecryptBlock(const uint8_t *key, const uint8_t *in, uint8_t *out)
+{
+    uint8_t roundKeys[AES_EXPANDED_KEY_SIZE];
+    uint8_t state[AES_BLOCK_SIZE];
+
+    aesExpandKey(key, roundKeys);
+
+    for (uint8_t i = 0; i < AES_BLOCK_SIZE; i++)
+    {
+        state[i] = in[i] ^ roundKeys[AES_ROUNDS * AES_BLOCK_SIZE + i];
+    }
+
+    for (uint8_t round = AES_ROUNDS; round >= 1; round--)
+    {
+        uint8_t temp[AES_BLOCK_SIZE];
+
+        /* InvShiftRows + InvSubBytes */
+        for (uint8_t i = 0; i < AES_BLOCK_SIZE; i++)
+        {
+            temp[(i + 4 * (i & 3)) & 15] = aesInvSbox[state[i]];
+        }
+
+        /* AddRoundKey */
+        for (uint8_t i = 0; i < AES_BLOCK_SIZE; i++)
+        {
+            temp[i] ^= roundKeys[(round - 1) * AES_BLOCK_SIZE + i];
+        }
+
+        /* InvMixColumns (skipped after the first inverse round) */
+        if (round != 1)
+        {
+            for (uint8_t c = 0; c < AES_BLOCK_SIZE; c += 4)
+            {
+                uint8_t a0 = temp[c], a1 = temp[c + 1], a2 = temp[c + 2], a3 = temp[c + 3];
+                temp[c]     = aesMul(a0, 14) ^ aesMul(a1, 11) ^ aesMul(a2, 13) ^ aesMul(a3, 9);
+                temp[c + 1] = aesMul(a0, 9)  ^ aesMul(a1, 14) ^ aesMul(a2, 11) ^ aesMul(a3, 13);
+                temp[c + 2] = aesMul(a0, 13) ^ aesMul(a1, 9)  ^ aesMul(a2, 14) ^ aesMul(a3, 11);
+                temp[c + 3] = aesMul(a0, 11) ^ aesMul(a1, 13) ^ aesMul(a2, 9)  ^ aesMul(a3, 14);
+            }
+        }
+
+        memcpy(state, temp, AES_BLOCK_SIZE);
+    }
+
+    memcpy(out, state, AES_BLOCK_SIZE);
+}
+
+/* Left shift of a 16 bytes block, used to derive the CMAC subkeys */
+static void aesShiftLeft(uint8_t *block)
+{
+    for (uint8_t i = 0; i < AES_BLOCK_SIZE - 1; i++)
+    {
+        block[i] = (uint8_t)((block[i] << 1) | (block[i + 1] >> 7));
+    }
+    block[AES_BLOCK_SIZE - 1] <<= 1;
+}
+
+/* AES-CMAC (RFC 4493), LoRaWAN MIC = first 4 bytes of the result */
+static void aesCmac(const uint8_t *key, const uint8_t *msg, uint16_t len, uint8_t *mac)
+{
+    uint8_t subkey[AES_BLOCK_SIZE] = {0};
+    uint8_t block[AES_BLOCK_SIZE];
+    uint8_t x[AES_BLOCK_SIZE] = {0};
+
+    /* K1 = L << 1 (^ Rb), K2 = K1 << 1 (^ Rb) */
+    aesEncryptBlock(key, subkey, subkey);
+    uint8_t msb = subkey[0] & 0x80;
+    aesShiftLeft(subkey);
+    if (msb)
+    {
+        subkey[AES_BLOCK_SIZE - 1] ^= 0x87;
+    }
+
+    bool complete = (len != 0) && ((len % AES_BLOCK_SIZE) == 0);
+    if (!complete)
+    {
+        msb = subkey[0] & 0x80;
+        aesShiftLeft(subkey);
+        if (msb)
+        {
+            subkey[AES_BLOCK_SIZE - 1] ^= 0x87;
+        }
+    }
+
+    uint16_t blocks = complete ? (len / AES_BLOCK_SIZE) : (len / AES_BLOCK_SIZE + 1);
+
+    for (uint16_t b = 0; b < blocks; b++)
+    {
+        uint16_t offset = b * AES_BLOCK_SIZE;
+
+        if (b == blocks - 1)
+        {
+            /* Last block: pad with 10..0 when incomplete, then XOR the subkey */
+            memset(block, 0, AES_BLOCK_SIZE);
+            memcpy(block, &msg[offset], len - offset);
+            if (!complete)
+            {
+                block[len - offset] = 0x80;
+            }
+            for (uint8_t i = 0; i < AES_BLOCK_SIZE; i++)
+            {
+                block[i] ^= subkey[i];
+            }
+        }
+        else
+        {
+            memcpy(block, &msg[offset], AES_BLOCK_SIZE);
+        }
+
+        for (uint8_t i = 0; i < AES_BLOCK_SIZE; i++)
+        {
+            x[i] ^= block[i];
+        }
+        aesEncryptBlock(key, x, x);
+    }
+
+    memcpy(mac, x, AES_BLOCK_SIZE);
+}
+
+/* LoRaWAN FRMPayload encryption (section 4.3.3), encrypt and decrypt are the same operation */
+static void aesLoRaWANPayload(const uint8_t *key, uint32_t devAddr, uint32_t fCnt, uint8_t dir, uint8_t *data, uint8_t len)
+{
+    uint8_t a[AES_BLOCK_SIZE];
+    uint8_t s[AES_BLOCK_SIZE];
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        if ((i % AES_BLOCK_SIZE) == 0)
+        {
+            memset(a, 0, AES_BLOCK_SIZE);
+            a[0]  = 0x01;
+            a[5]  = dir;
+            a[6]  = (uint8_t)(devAddr);
+            a[7]  = (uint8_t)(devAddr >> 8);
+            a[8]  = (uint8_t)(devAddr >> 16);
+            a[9]  = (uint8_t)(devAddr >> 24);
+            a[10] = (uint8_t)(fCnt);
+            a[11] = (uint8_t)(fCnt >> 8);
+            a[12] = (uint8_t)(fCnt >> 16);
+            a[13] = (uint8_t)(fCnt >> 24);
+            a[15] = (uint8_t)(i / AES_BLOCK_SIZE + 1);
+            aesEncryptBlock(key, a, s);
+        }
+        data[i] ^= s[i % AES_BLOCK_SIZE];
+    }
+}
+
+/* LoRaWAN data frame MIC (section 4.4): cmac(NwkSKey, B0 | msg)[0..3] */
+static uint32_t aesLoRaWANMic(const uint8_t *key, uint32_t devAddr, uint32_t fCnt, uint8_t dir, const uint8_t *msg, uint8_t len)
+{
+    uint8_t buffer[AES_BLOCK_SIZE + 255];
+    uint8_t mac[AES_BLOCK_SIZE];
+
+    memset(buffer, 0, AES_BLOCK_SIZE);
+    buffer[0]  = 0x49;
+    buffer[5]  = dir;
+    buffer[6]  = (uint8_t)(devAddr);
+    buffer[7]  = (uint8_t)(devAddr >> 8);
+    buffer[8]  = (uint8_t)(devAddr >> 16);
+    buffer[9]  = (uint8_t)(devAddr >> 24);
+    buffer[10] = (uint8_t)(fCnt);
+    buffer[11] = (uint8_t)(fCnt >> 8);
+    buffer[12] = (uint8_t)(fCnt >> 16);
+    buffer[13] = (uint8_t)(fCnt >> 24);
+    buffer[15] = len;
+    memcpy(&buffer[AES_BLOCK_SIZE], msg, len);
+
+    aesCmac(key, buffer, AES_BLOCK_SIZE + len, mac);
+
+    /* MIC is transmitted little-endian */
+    return (uint32_t)mac[0] | ((uint32_t)mac[1] << 8) | ((uint32_t)mac[2] << 16) | ((uint32_t)mac[3] << 24);
+}
+
+#ifdef USE_LMIC_AES_HOOK
+#ifndef LMIC_AES_EXTERNAL
+#error "USE_LMIC_AES_HOOK needs a patched LMiC, run tools/lmic_aes_hook.sh"
+#endif
+
+/* Block function used by LMiC's os_aes(), encrypts data in place */
+extern "C" void lmic_aes_encrypt(uint8_t *data, uint8_t *key)
+{
+    aesEncryptBlock(key, data, data);
+}
+#endif
+
+/*
+ *  Known-answer tests
+ *
+ *  FIPS-197 (appendix C.1), RFC 4493 (examples 2 and 4) and a real LoRaWAN
+ *  exchange with The Things Network captured at the gateway (see _useful.ino):
+ *  join request "AAEXA9B+1bNw8OS9D+9bJwBFN37uDrU=", join accept
+ *  "IFskvyGfiBxj7+un82Xh0PQ=" and the first uplink "QMUmAyYAAABll2Y8tWcHNMvlsvlWalY=",
+ *  all with the TTN APPKEY of _credentials.h.
+ */
+typedef void (*aesEncryptFunction_t)(const uint8_t *key, const uint8_t *in, uint8_t *out);
+
+typedef struct
+{
+    const char           *name;
+    aesEncryptFunction_t  encrypt;
+} aesBackend_t;
+
+/* Every backend compiled in, the selected one is always the last */
+static const aesBackend_t aesBackends[] = {
+    {"Reference", aesReferenceEncryptBlock},
+    {"Table",     aesTableEncryptBlock},
+#if AES_BACKEND == AES_BACKEND_HARDWARE
+    {"Hardware",  aesHardwareEncryptBlock},
+#endif
+};
+
+#define AES_BACKENDS_COUNT          (sizeof(aesBackends) / sizeof(aesBackends[0]))
+
+static bool aesSelfTest()
+{
+    static const uint8_t fipsKey[16]       = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F};
+    static const uint8_t fipsPlain[16]     = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF};
+    static const uint8_t fipsCipher[16]    = {0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30, 0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A};
+
+    static const uint8_t rfcKey[16]        = {0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C};
+    static const uint8_t rfcMessage[16]    = {0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96, 0xE9, 0x3D, 0x7E, 0x11, 0x73, 0x93, 0x17, 0x2A};
+    static const uint8_t rfcMac[16]        = {0x07, 0x0A, 0x16, 0xB4, 0x6B, 0x4D, 0x41, 0x44, 0xF7, 0x9B, 0xDD, 0x9D, 0xD0, 0x4A, 0x28, 0x7C};
+
+    static const uint8_t ttnAppKey[16]     = {0x70, 0xDC, 0xA9, 0x80, 0x78, 0x37, 0x4C, 0x51, 0x63, 0x3E, 0x4D, 0x73, 0x16, 0xA6, 0xB3, 0xB1};
+    static const uint8_t ttnJoinRequest[23] = {0x00, 0x01, 0x17, 0x03, 0xD0, 0x7E, 0xD5, 0xB3, 0x70, 0xF0, 0xE4, 0xBD, 0x0F, 0xEF, 0x5B, 0x27,
+                                               0x00, 0x45, 0x37, 0x7E, 0xEE, 0x0E, 0xB5};
+    static const uint8_t ttnJoinAccept[17] = {0x20, 0x5B, 0x24, 0xBF, 0x21, 0x9F, 0x88, 0x1C, 0x63, 0xEF, 0xEB, 0xA7, 0xF3, 0x65, 0xE1, 0xD0, 0xF4};
+    static const uint8_t ttnAcceptPlain[16] = {0x12, 0xE9, 0x13, 0x13, 0x00, 0x00, 0xC5, 0x26, 0x03, 0x26, 0x08, 0x01, 0xAE, 0x54, 0xA7, 0x82};
+    static const uint8_t ttnUplink[23]     = {0x40, 0xC5, 0x26, 0x03, 0x26, 0x00, 0x00, 0x00, 0x65, 0x97, 0x66, 0x3C, 0xB5, 0x67, 0x07, 0x34,
+                                               0xCB, 0xE5, 0xB2, 0xF9, 0x56, 0x6A, 0x56};
+
+    uint8_t block[AES_BLOCK_SIZE];
+
+    /* Every backend must produce the FIPS-197 ciphertext */
+    for (uint8_t i = 0; i < AES_BACKENDS_COUNT; i++)
+    {
+        aesBackends[i].encrypt(fipsKey, fipsPlain, block);
+        if (memcmp(block, fipsCipher, AES_BLOCK_SIZE) != 0)
+        {
+            return false;
+        }
+    }
+
+    /* The remaining vectors go through aesEncryptBlock(), i.e. the selected backend */
+    aesCmac(rfcKey, rfcMessage, sizeof(rfcMessage), block);
+    if (memcmp(block, rfcMac, AES_BLOCK_SIZE) != 0)
+    {
+        return false;
+    }
+
+    /* Join request MIC */
+    aesCmac(ttnAppKey, ttnJoinRequest, 19, block);
+    if (memcmp(block, &ttnJoinRequest[19], 4) != 0)
+    {
+        return false;
+    }
+
+    /* Join accept: the node decrypts with the forward cipher */
+    aesEncryptBlock(ttnAppKey, &ttnJoinAccept[1], block);
+    if (memcmp(block, ttnAcceptPlain, AES_BLOCK_SIZE) != 0)
+    {
+        return false;
+    }
+
+    /* Session keys from AppNonce | NetID | DevNonce, then the first uplink MIC and payload */
+    uint8_t nwkSKey[AES_BLOCK_SIZE];
+    uint8_t appSKey[AES_BLOCK_SIZE];
+    uint8_t payload[10];
+
+    memset(block, 0, AES_BLOCK_SIZE);
+    memcpy(&block[1], ttnAcceptPlain, 6);
+    memcpy(&block[7], &ttnJoinRequest[17], 2);
+    block[0] = 0x01;
+    aesEncryptBlock(ttnAppKey, block, nwkSKey);
+    block[0] = 0x02;
+    aesEncryptBlock(ttnAppKey, block, appSKey);
+
+    uint32_t mic = (uint32_t)ttnUplink[19] | ((uint32_t)ttnUplink[20] << 8) | ((uint32_t)ttnUplink[21] << 16) | ((uint32_t)ttnUplink[22] << 24);
+    if (aesLoRaWANMic(nwkSKey, 0x260326C5, 0, 0, ttnUplink, 19) != mic)
+    {
+        return false;
+    }
+
+    memcpy(payload, &ttnUplink[9], sizeof(payload));
+    aesLoRaWANPayload(appSKey, 0x260326C5, 0, 0, payload, sizeof(payload));
+
+    return memcmp(payload, "AdailSilva", sizeof(payload)) == 0;
+}
@@ -57,10 +57,8 @@ void IRAM_ATTR resetModule()
 
 void downlinksControlTime()
 {
-    #ifdef RX_DELAY
-    /* Set the delay for the first RX window in seconds */
-    LMIC.rxDelay = RX_DELAY;
-    #endif
+    /* Set the delay for the first RX window in seconds (network profile, default RX_DELAY) */
+    LMIC.rxDelay = networkProfile.rxDelay;
     
     #ifdef CLOCK_ERROR
         /* Let LMIC compensate for +/- n% clock error, Value default MAX_CLOCK_ERROR: 65536 */
@@ -70,6 +68,8 @@ void downlinksControlTime()
 
 void downlinksRule()
 {
+    PROFILE_SCOPE(PROFILER_DOWNLINKS_RULE);
+    
     /* LMIC.dataBeg - 1 (- 2, - 3, - 4, ...) Defines the position of each frame index */
 
     if (LMIC.dataLen == 1)
@@ -99,7 +99,7 @@ void downlinksRule()
             /* Tem mais sentido em Classe C, porém LMiC trabalha apenas em classes A e B. */
             //do_send(&sendjob); /* When so called, shipping goes without Payload */
             /* After calling function do_send, you don't get here */
-            payloadSend(UPLINK_PORT, payloadRelayUplink, sizeof(payloadRelayUplink), UPLINK_CONFIRMED);
+            payloadRelayUplink();
         }
         
     }
@@ -126,7 +126,7 @@ void downlinksRule()
         
         /*
          *  Downlink structure --> { 0x55, cmd, dat0, dat1, 0xFF }
-         *  @cmd                  : Set interval - 01, Reboot - 02.
+         *  @cmd                  : Set interval - 01, Reboot - 02, Select network profile - 03, Energy anchor - 04.
          *  @dat                  : 2 bytes data
          *  New Interval Example  : 55 01 00 1E FF on FPort 255
          *  Base64                : VQEAHv8=
@@ -135,6 +135,14 @@ void downlinksRule()
          *  Reboot Example        : 55 02 00 00 FF on FPort 255
          *  Base64                : VQIAAP8=
          *  Effect                : Reboot...
+         *  
+         *  Profile Example       : 55 03 00 01 FF on FPort 255
+         *  Base64                : VQMAAf8=
+         *  Effect                : Profile 1 of the credentials store is saved as active, then Reboot...
+         *  
+         *  Anchor Example        : 55 04 00 00 FF on FPort 255
+         *  Base64                : VQQAAP8=
+         *  Effect                : Next energy uplink carries the absolute total
          */
         if (header == 0x55 & tail == 0xFF)
         {
@@ -168,8 +176,66 @@ void downlinksRule()
                 /* Reset */
                 resetModule();
             }
+            
+            #ifdef USE_CREDENTIALS_STORE
+            /* 
+             *  Selecting the profile that is already active returns false,
+             *  so a repeated downlink does not reboot the module again.
+             */
+            if (cmd == 0x03)
+            {
+                #ifdef DEBUG
+                DEBUG_PORT.println(" [INFO] Received SELECT_PROFILE request: " + String(dat));
+                #endif
+                if (dat <= 0xFF && credentialsSelectProfile(dat))
+                {
+                    #ifdef DEBUG
+                    DEBUG_PORT.println(F(" [INFO] Resetting the Module in 10 seconds... ~('.')~"));
+                    #endif
+                    /* Reset */
+                    resetModule();
+                }
+            }
+            #endif
+            
+            #ifdef USE_ENERGY_ACCUMULATOR
+            if (cmd == 0x04)
+            {
+                #ifdef DEBUG
+                DEBUG_PORT.println(F(" [INFO] Received ENERGY_ANCHOR request"));
+                #endif
+                energyRequestAnchor();
+            }
+            #endif
         }
     }    
+    #ifdef USE_FUOTA
+    else if (LMIC.dataLen > 0 && LMIC.frame[LMIC.dataBeg - 1] == FUOTA_PORT)
+    {
+        /* Fragmented firmware update, see _fuota.h for the commands */
+        u1_t previous = fuota.state;
+        u1_t state = fuotaDownlink(LMIC.frame + LMIC.dataBeg, LMIC.dataLen);
+        
+        if (state == FUOTA_APPLY)
+        {
+            #ifdef DEBUG
+            DEBUG_PORT.println(F(" [INFO] Received FUOTA_APPLY request"));
+            DEBUG_PORT.println(F(" [INFO] Resetting the Module in 10 seconds... ~('.')~"));
+            #endif
+            /* Reset, boots the new image */
+            resetModule();
+        }
+        
+        /* Status on request and whenever the session changes state */
+        if (state != previous || LMIC.frame[LMIC.dataBeg] == FUOTA_CMD_STATUS)
+        {
+            #ifdef DEBUG
+            DEBUG_PORT.println(" [INFO] FUOTA state         : " + String(state) + ", missing " + String(fuotaMissing()));
+            #endif
+            payloadFuotaStatus();
+        }
+    }
+    #endif
     else
     {
         /* Default Port 0 */
@@ -0,0 +1,215 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+#pragma once
+
+/* Includes */
+#include <Arduino.h>
+#include "_spsc.h"
+
+/*
+ *  Dual core mode (ESP32)
+ *  
+ *  DUAL_CORE_LMIC_CORE   : lmictask(), os_runloop_once() at DUAL_CORE_LMIC_PRIORITY and nothing else.
+ *  DUAL_CORE_WORKER_CORE : metertask(), Modbus reads,
+ *                          dualCoreLogTask(), the only writer of the serial port.
+ *  
+ *  Unlike the original plan, which had acquisition, aggregation and log
+ *  draining on a core of their own, the log task shares the worker core with
+ *  metertask() at the same priority, and the aggregation (samplefunc(): energy
+ *  accumulator, event detector) stays on the LMiC core, where energyPayload()
+ *  reads it without a lock.
+ *  
+ *  The tasks only talk through SPSC queues (_spsc.h): readings go to samplefunc()
+ *  on the LMiC side, log lines go to the log task. Every task that logs gets
+ *  its own line buffer and queue the first time it does (DUAL_CORE_LOG_PRODUCERS
+ *  of them, by task handle), so setup() on the loop() task and lmictask() on the
+ *  same core never share a queue or a half-built line. tests/test_dual_core.cpp
+ *  runs the same design with a std::thread per task. Including this file redirects
+ *  DEBUG_PORT to dualCoreLog, so every existing DEBUG_PORT.print()/println() call
+ *  only formats the line and queues it, instead of waiting on the UART. Lines
+ *  that do not fit in the queue, or come from a task beyond the producer table,
+ *  are dropped and counted, never waited for. Reads (provisioning, profiler key)
+ *  still go straight to Serial.
+ */
+
+/* Types */
+typedef struct
+{
+    char text[DUAL_CORE_LOG_LINE];
+} dualCoreLine_t;
+
+/* A task that logs: only that task builds lines and pushes, the log task pops */
+typedef struct
+{
+    std::atomic<TaskHandle_t>                      task;      /* NULL while free */
+    String                                         pending;   /* Line being built */
+    spscQueue<dualCoreLine_t, DUAL_CORE_LOG_QUEUE> queue;
+} dualCoreLogProducer_t;
+
+/* Variables */
+dualCoreLogProducer_t dualCoreLogProducers[DUAL_CORE_LOG_PRODUCERS];
+std::atomic<uint32_t> dualCoreLogUnregistered(0);     /* Lines of tasks beyond the table */
+
+/* Functions */
+/* Slot of the calling task, claimed on its first line; NULL when the table is full */
+dualCoreLogProducer_t *dualCoreLogProducer()
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+
+    for (uint8_t i = 0; i < DUAL_CORE_LOG_PRODUCERS; i++)
+    {
+        if (dualCoreLogProducers[i].task.load(std::memory_order_acquire) == task)
+        {
+            return &dualCoreLogProducers[i];
+        }
+    }
+    for (uint8_t i = 0; i < DUAL_CORE_LOG_PRODUCERS; i++)
+    {
+        TaskHandle_t none = NULL;
+        if (dualCoreLogProducers[i].task.compare_exchange_strong(none, task, std::memory_order_acq_rel))
+        {
+            return &dualCoreLogProducers[i];
+        }
+    }
+    return NULL;
+}
+
+/* Serial look-alike used as DEBUG_PORT */
+struct dualCoreLogPort
+{
+
+    void begin(unsigned long baud) { Serial.begin(baud); }
+    operator bool() { return (bool)Serial; }
+    int available() { return Serial.available(); }
+    int read() { return Serial.read(); }
+    void setTimeout(unsigned long timeout) { Serial.setTimeout(timeout); }
+    size_t readBytes(uint8_t *buffer, size_t length) { return Serial.readBytes(buffer, length); }
+
+    template <typename T> void print(T value) { append(String(value)); }
+    template <typename T> void print(T value, int base) { append(String(value, base)); }
+    template <typename T> void println(T value) { print(value); println(); }
+    template <typename T> void println(T value, int base) { print(value, base); println(); }
+
+    void append(const String &text)
+    {
+        dualCoreLogProducer_t *producer = dualCoreLogProducer();
+        if (producer != NULL)
+        {
+            producer->pending += text;
+        }
+    }
+
+    void println()
+    {
+        dualCoreLogProducer_t *producer = dualCoreLogProducer();
+        dualCoreLine_t         line;
+
+        if (producer == NULL)
+        {
+            dualCoreLogUnregistered.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        strncpy(line.text, producer->pending.c_str(), sizeof(line.text) - 1);
+        line.text[sizeof(line.text) - 1] = '\0';
+        producer->queue.push(line);
+        producer->pending = "";
+    }
+};
+
+dualCoreLogPort dualCoreLog;
+
+#undef DEBUG_PORT
+#define DEBUG_PORT                  dualCoreLog
+
+/* Lines dropped so far, full queues and tasks without a slot */
+uint32_t dualCoreLogDropped()
+{
+    uint32_t dropped = dualCoreLogUnregistered.load();
+    for (uint8_t i = 0; i < DUAL_CORE_LOG_PRODUCERS; i++)
+    {
+        dropped += dualCoreLogProducers[i].queue.dropped.load();
+    }
+    return dropped;
+}
+
+/* Worker core: the only task writing to the serial port */
+void dualCoreLogTask(void *parameter)
+{
+    dualCoreLine_t line;
+    uint32_t       reported = 0;
+
+    for (;;)
+    {
+        bool idle = true;
+        for (uint8_t i = 0; i < DUAL_CORE_LOG_PRODUCERS; i++)
+        {
+            while (dualCoreLogProducers[i].queue.pop(&line))
+            {
+                Serial.println(line.text);
+                idle = false;
+            }
+        }
+
+        uint32_t dropped = dualCoreLogDropped();
+        if (dropped != reported)
+        {
+            Serial.println(" [WARN] Log lines dropped   : " + String(dropped - reported));
+            reported = dropped;
+        }
+
+        if (idle)
+        {
+            vTaskDelay(pdMS_TO_TICKS(DUAL_CORE_LOG_PERIOD_MS));
+        }
+    }
+}
+
+/* Call right after DEBUG_PORT.begin() */
+void dualCoreBegin()
+{
+    xTaskCreatePinnedToCore(dualCoreLogTask, "log", DUAL_CORE_WORKER_STACK, NULL, 1, NULL, DUAL_CORE_WORKER_CORE);
+}
@@ -0,0 +1,276 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+#pragma once
+
+/* Includes */
+#include <lmic.h>
+#if defined(ARDUINO_ARCH_ESP32)
+#include <Preferences.h>    /* NVS */
+#else
+#include <EEPROM.h>
+#endif
+
+/*
+ *  Energy Accumulator
+ *  
+ *  Monotonic energy total (Wh) built from the cumulative counter of the
+ *  PZEM-004T, which wraps at ENERGY_METER_WRAP_WH and goes back to zero
+ *  when the meter is reset or replaced:
+ *  
+ *  counter went up                   : total += new - last
+ *  counter went down near the wrap   : total += (WRAP - last) + new
+ *  counter went down anywhere else   : meter reset, total += new
+ *  
+ *  Persistence: the state is mirrored in RTC memory on every sample (survives
+ *  resets, costs nothing) and written to NVS/EEPROM only every
+ *  ENERGY_PERSIST_STEP_WH. After a power cut the meter counter itself still
+ *  holds what was consumed meanwhile, so the first reading after boot
+ *  recovers it from the last persisted counter value.
+ *  
+ *  Uplinks on ENERGY_UPLINK_PORT, MSB first, the length tells the frame type:
+ *  Anchor : | 1 | 0000 | id (3 bits) | total, Wh (32 bits) |        5 bytes
+ *  Delta  : | 0 | id (3 bits) | total - anchor total, Wh (12 bits) | 2 bytes, up to 4095 Wh
+ *  Delta  : | 0 | id (3 bits) | total - anchor total, Wh (20 bits) | 3 bytes, up to 1048575 Wh
+ *  
+ *  Deltas are relative to the anchor, not to the previous frame, so a lost
+ *  delta costs nothing: total = anchor[id] + delta. The server keeps the last
+ *  anchor of each of the 8 ids with its FCnt and drops a delta more than
+ *  ENERGY_ANCHOR_INTERVAL frames after it: its own anchor was lost and the
+ *  id is a reused one (see tests/test_energy.cpp). FCnt also counts the
+ *  other uplinks of the node (events, supervisor reports, relay answers), so
+ *  this window is in uplinks, not in deltas: with other traffic in between
+ *  it drops more, never less. When FCnt goes back (rejoin, reboot) the
+ *  server forgets every anchor of the previous session.
+ *  
+ *  An anchor goes out after boot, every ENERGY_ANCHOR_INTERVAL frames, when
+ *  the delta needs more than 20 bits, or on request (downlink command 0x04).
+ *  The last anchor id is part of the persisted state, so the boot anchor
+ *  takes the next id instead of starting over at 1.
+ */
+
+/* Definitions */
+#define ENERGY_MAGIC                0x454E5247  /* "ENRG" */
+#define ENERGY_NVS_NAMESPACE        "lorawan"
+#define ENERGY_NVS_KEY              "energy"
+#define ENERGY_PAYLOAD_MAX          5
+#define ENERGY_ANCHOR_FLAG          0x80
+#define ENERGY_ANCHOR_ID_MASK       0x07
+#define ENERGY_DELTA_SHORT_MAX      0xFFFUL     /* 12 bits */
+#define ENERGY_DELTA_LONG_MAX       0xFFFFFUL   /* 20 bits */
+
+/* Types */
+typedef struct
+{
+    u4_t magic;
+    u4_t total;         /* Wh, monotonic */
+    u4_t lastMeter;     /* Last counter value read from the meter, Wh */
+    u1_t anchorId;      /* Id of the last anchor sent */
+    u4_t check;
+} energyState_t;
+
+/* Variables */
+#if defined(ARDUINO_ARCH_ESP32)
+RTC_NOINIT_ATTR energyState_t energyRtc;    /* Not cleared by esp_restart() or the watchdog */
+#endif
+energyState_t energyState;
+bool          energyHasMeter      = false;  /* lastMeter holds a real reading */
+u4_t          energyPersistedTotal = 0;
+u4_t          energyAnchorTotal   = 0;
+u1_t          energyFrames        = 0;      /* Delta frames since the last anchor */
+bool          energyAnchorNeeded  = true;
+
+/* Functions */
+static u4_t energyCheck(const energyState_t *state)
+{
+    return state->magic ^ state->total ^ state->lastMeter ^ state->anchorId ^ 0xA5A5A5A5;
+}
+
+static bool energyValid(const energyState_t *state)
+{
+    return state->magic == ENERGY_MAGIC && state->check == energyCheck(state);
+}
+
+static void energySeal(energyState_t *state)
+{
+    state->magic = ENERGY_MAGIC;
+    state->check = energyCheck(state);
+}
+
+/* RTC copy of the state, ESP32 only */
+static void energyMirror()
+{
+#if defined(ARDUINO_ARCH_ESP32)
+    energySeal(&energyState);
+    memcpy(&energyRtc, &energyState, sizeof(energyState));
+#endif
+}
+
+void energyPersist()
+{
+    energySeal(&energyState);
+
+#if defined(ARDUINO_ARCH_ESP32)
+    Preferences preferences;
+    preferences.begin(ENERGY_NVS_NAMESPACE, false);
+    preferences.putBytes(ENERGY_NVS_KEY, &energyState, sizeof(energyState));
+    preferences.end();
+#else
+    EEPROM.put(ENERGY_EEPROM_ADDRESS, energyState);
+    #if defined(ESP8266)
+    EEPROM.commit();
+    #endif
+#endif
+
+    energyPersistedTotal = energyState.total;
+}
+
+/* RTC copy first (newest), then NVS/EEPROM, then zero */
+void energyBegin()
+{
+#if defined(ARDUINO_ARCH_ESP32)
+    if (energyValid(&energyRtc))
+    {
+        memcpy(&energyState, &energyRtc, sizeof(energyState));
+    }
+    else
+    {
+        Preferences preferences;
+        preferences.begin(ENERGY_NVS_NAMESPACE, true);
+        size_t size = preferences.getBytes(ENERGY_NVS_KEY, &energyState, sizeof(energyState));
+        preferences.end();
+        if (size != sizeof(energyState) || !energyValid(&energyState))
+        {
+            memset(&energyState, 0, sizeof(energyState));
+        }
+    }
+#else
+    #if defined(ESP8266)
+    EEPROM.begin(ENERGY_EEPROM_ADDRESS + sizeof(energyState));
+    #endif
+    EEPROM.get(ENERGY_EEPROM_ADDRESS, energyState);
+    if (!energyValid(&energyState))
+    {
+        memset(&energyState, 0, sizeof(energyState));
+    }
+#endif
+
+    energyHasMeter       = energyValid(&energyState);
+    energyPersistedTotal = energyState.total;
+    energyAnchorNeeded   = true;
+}
+
+/* One valid meter reading, meterWh is the cumulative counter of the meter */
+void energyUpdate(u4_t meterWh)
+{
+    if (!energyHasMeter)
+    {
+        /* First reading ever: nothing to add, it is the reference */
+        energyHasMeter = true;
+    }
+    else if (meterWh >= energyState.lastMeter)
+    {
+        energyState.total += meterWh - energyState.lastMeter;
+    }
+    else if (energyState.lastMeter > ENERGY_METER_WRAP_WH - ENERGY_METER_WRAP_WH / 10 && meterWh < ENERGY_METER_WRAP_WH / 10)
+    {
+        /* Counter wrapped */
+        energyState.total += (ENERGY_METER_WRAP_WH - energyState.lastMeter) + meterWh;
+    }
+    else
+    {
+        /* Meter reset or replaced, it counted meterWh since then */
+        energyState.total += meterWh;
+    }
+    energyState.lastMeter = meterWh;
+    energyMirror();
+
+    if (energyState.total - energyPersistedTotal >= ENERGY_PERSIST_STEP_WH)
+    {
+        energyPersist();
+    }
+}
+
+/* Next uplink carries an anchor */
+void energyRequestAnchor()
+{
+    energyAnchorNeeded = true;
+}
+
+/* Builds the next energy uplink, returns its length */
+u1_t energyPayload(u1_t *payload)
+{
+    u4_t delta = energyState.total - energyAnchorTotal;
+
+    if (energyAnchorNeeded || energyFrames >= ENERGY_ANCHOR_INTERVAL || delta > ENERGY_DELTA_LONG_MAX)
+    {
+        energyState.anchorId = (energyState.anchorId + 1) & ENERGY_ANCHOR_ID_MASK;
+        energyAnchorTotal    = energyState.total;
+        energyAnchorNeeded   = false;
+        energyFrames         = 0;
+        energyMirror();
+
+        payload[0] = ENERGY_ANCHOR_FLAG | energyState.anchorId;
+        payload[1] = (u1_t)(energyAnchorTotal >> 24);
+        payload[2] = (u1_t)(energyAnchorTotal >> 16);
+        payload[3] = (u1_t)(energyAnchorTotal >> 8);
+        payload[4] = (u1_t)(energyAnchorTotal);
+        return 5;
+    }
+
+    /* Anchor id in the top nibble, bit 7 clear */
+    energyFrames++;
+    if (delta > ENERGY_DELTA_SHORT_MAX)
+    {
+        payload[0] = (u1_t)(energyState.anchorId << 4) | (u1_t)(delta >> 16);
+        payload[1] = (u1_t)(delta >> 8);
+        payload[2] = (u1_t)(delta);
+        return 3;
+    }
+    payload[0] = (u1_t)(energyState.anchorId << 4) | (u1_t)(delta >> 8);
+    payload[1] = (u1_t)(delta);
+    return 2;
+}
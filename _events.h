@@ -0,0 +1,229 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+#pragma once
+
+/* Includes */
+#include <lmic.h>
+#include "_airtime.h"
+#include "_meter.h"
+#include "_payloads.h"
+
+/*
+ *  Event Detection
+ *  
+ *  Streaming detector on the meter samples, fixed-point and O(1) per sample:
+ *  
+ *  OUTAGE / RESTORE  : meter silent or voltage below EVENTS_OUTAGE_VOLTAGE, and back.
+ *  OVERVOLTAGE       : instantaneous voltage above EVENTS_OVERVOLTAGE.
+ *  SAG / SWELL       : voltage outside nominal -/+ EVENTS_SAG_SWELL_PERCENT for
+ *                      EVENTS_SAG_SWELL_SAMPLES consecutive samples.
+ *  LOAD_SPIKE        : power step between two samples above EVENTS_POWER_STEP.
+ *  
+ *  Events are edge-triggered: a condition is reported once when it starts and
+ *  re-armed when it ends (with hysteresis), so a long sag is one event, not one
+ *  per sample. Detected events are OR-ed into eventsPending until an uplink
+ *  carries them (see do_send_event in LoRaWAN_Node_Skeleton.ino).
+ *  
+ *  Event uplink on EVENTS_UPLINK_PORT, 6 bytes, MSB first:
+ *  | flags (1) | voltage, 0.1 V (2) | power, 0.1 W (3) |
+ */
+
+/* Definitions */
+#define EVENT_OUTAGE                0x01
+#define EVENT_RESTORE               0x02
+#define EVENT_OVERVOLTAGE           0x04
+#define EVENT_SAG                   0x08
+#define EVENT_SWELL                 0x10
+#define EVENT_LOAD_SPIKE            0x20
+
+/* Event uplink: | events (1) | voltage, 0.1 V (2) | power, 0.1 W (3) | */
+typedef payloadMessage<payloadUnsigned<1>, payloadUnsigned<2>, payloadUnsigned<3> > eventsMessage_t;
+
+#define EVENTS_PAYLOAD_SIZE         eventsMessage_t::size
+
+/* Limits in 0.1 V, derived once at compile time */
+#define EVENTS_SAG_VOLTAGE          (EVENTS_NOMINAL_VOLTAGE * (100 - EVENTS_SAG_SWELL_PERCENT) / 100)
+#define EVENTS_SWELL_VOLTAGE        (EVENTS_NOMINAL_VOLTAGE * (100 + EVENTS_SAG_SWELL_PERCENT) / 100)
+#define EVENTS_HYSTERESIS           (EVENTS_NOMINAL_VOLTAGE / 100)     /* 1% of nominal */
+
+/* Variables */
+u1_t  eventsPending       = 0;      /* Events waiting for an uplink */
+u1_t  eventsActive        = 0;      /* Conditions currently present (edge detection) */
+u1_t  eventsSagCount      = 0;
+u1_t  eventsSwellCount    = 0;
+u1_t  eventsNormalCount   = 0;
+u4_t  eventsLastPower     = 0;
+bool  eventsHasLastPower  = false;
+u2_t  eventsVoltage       = 0;      /* Sample that raised the last event */
+u4_t  eventsPower         = 0;
+
+/* Airtime token bucket, in ms of airtime */
+u4_t  eventsAirtimeTokens = EVENTS_AIRTIME_BUDGET_MS;
+u4_t  eventsAirtimeLastMs = 0;
+
+/* Functions */
+static void eventsRaise(u1_t event, const meterReading_t *reading)
+{
+    eventsPending |= event;
+    eventsVoltage  = reading->voltage;
+    eventsPower    = reading->power;
+}
+
+/* Returns the events raised by this sample */
+u1_t eventsSample(const meterReading_t *reading)
+{
+    u1_t before = eventsPending;
+
+    /* Outage: enters and leaves on a single sample */
+    bool outage = !reading->valid || reading->voltage < EVENTS_OUTAGE_VOLTAGE;
+    if (outage && !(eventsActive & EVENT_OUTAGE))
+    {
+        eventsActive |= EVENT_OUTAGE;
+        eventsRaise(EVENT_OUTAGE, reading);
+    }
+    else if (!outage && (eventsActive & EVENT_OUTAGE))
+    {
+        eventsActive &= ~EVENT_OUTAGE;
+        eventsRaise(EVENT_RESTORE, reading);
+    }
+
+    if (outage)
+    {
+        /* Nothing else makes sense without voltage, restart the windows */
+        eventsSagCount     = 0;
+        eventsSwellCount   = 0;
+        eventsHasLastPower = false;
+        eventsActive      &= EVENT_OUTAGE;
+        return eventsPending & ~before;
+    }
+
+    /* Overvoltage: instantaneous, re-armed below the limit minus hysteresis */
+    if (reading->voltage > EVENTS_OVERVOLTAGE && !(eventsActive & EVENT_OVERVOLTAGE))
+    {
+        eventsActive |= EVENT_OVERVOLTAGE;
+        eventsRaise(EVENT_OVERVOLTAGE, reading);
+    }
+    else if (reading->voltage < EVENTS_OVERVOLTAGE - EVENTS_HYSTERESIS)
+    {
+        eventsActive &= ~EVENT_OVERVOLTAGE;
+    }
+
+    /* Sag / swell: consecutive samples outside the band, saturated counters */
+    eventsSagCount    = (reading->voltage < EVENTS_SAG_VOLTAGE)   ? (eventsSagCount   < 0xFF ? eventsSagCount   + 1 : 0xFF) : 0;
+    eventsSwellCount  = (reading->voltage > EVENTS_SWELL_VOLTAGE) ? (eventsSwellCount < 0xFF ? eventsSwellCount + 1 : 0xFF) : 0;
+    bool normal       = reading->voltage > EVENTS_SAG_VOLTAGE + EVENTS_HYSTERESIS && reading->voltage < EVENTS_SWELL_VOLTAGE - EVENTS_HYSTERESIS;
+    eventsNormalCount = normal ? (eventsNormalCount < 0xFF ? eventsNormalCount + 1 : 0xFF) : 0;
+
+    if (eventsSagCount == EVENTS_SAG_SWELL_SAMPLES && !(eventsActive & EVENT_SAG))
+    {
+        eventsActive |= EVENT_SAG;
+        eventsRaise(EVENT_SAG, reading);
+    }
+    if (eventsSwellCount == EVENTS_SAG_SWELL_SAMPLES && !(eventsActive & EVENT_SWELL))
+    {
+        eventsActive |= EVENT_SWELL;
+        eventsRaise(EVENT_SWELL, reading);
+    }
+    if (eventsNormalCount >= EVENTS_SAG_SWELL_SAMPLES)
+    {
+        eventsActive &= ~(EVENT_SAG | EVENT_SWELL);
+    }
+
+    /* Load spike: rate of change of the power between two samples */
+    if (eventsHasLastPower)
+    {
+        u4_t step = (reading->power > eventsLastPower) ? reading->power - eventsLastPower : eventsLastPower - reading->power;
+        if (step > EVENTS_POWER_STEP && !(eventsActive & EVENT_LOAD_SPIKE))
+        {
+            eventsActive |= EVENT_LOAD_SPIKE;
+            eventsRaise(EVENT_LOAD_SPIKE, reading);
+        }
+        else if (step <= EVENTS_POWER_STEP / 2)
+        {
+            eventsActive &= ~EVENT_LOAD_SPIKE;
+        }
+    }
+    eventsLastPower    = reading->power;
+    eventsHasLastPower = true;
+
+    return eventsPending & ~before;
+}
+
+/* Refills the airtime bucket, EVENTS_AIRTIME_BUDGET_MS per hour */
+static void eventsAirtimeRefill(u4_t nowMs)
+{
+    u4_t elapsed = nowMs - eventsAirtimeLastMs;
+    u4_t refill  = (u4_t)((uint64_t)elapsed * EVENTS_AIRTIME_BUDGET_MS / 3600000UL);
+
+    if (refill > 0)
+    {
+        eventsAirtimeTokens  = (eventsAirtimeTokens + refill > EVENTS_AIRTIME_BUDGET_MS) ? EVENTS_AIRTIME_BUDGET_MS : eventsAirtimeTokens + refill;
+        eventsAirtimeLastMs += (u4_t)((uint64_t)refill * 3600000UL / EVENTS_AIRTIME_BUDGET_MS);
+    }
+}
+
+/* True if an event uplink at this data rate fits in the airtime budget, the airtime is taken */
+bool eventsAirtimeTake(u1_t dr, u4_t nowMs)
+{
+    u4_t cost = airtimeMs(dr, LORAWAN_OVERHEAD + EVENTS_PAYLOAD_SIZE);
+
+    eventsAirtimeRefill(nowMs);
+    if (eventsAirtimeTokens < cost)
+    {
+        return false;
+    }
+    eventsAirtimeTokens -= cost;
+    return true;
+}
+
+/* Builds the event uplink and clears the pending events, returns its length */
+u1_t eventsPayload(u1_t *payload)
+{
+    u1_t length = eventsMessage_t::encode(payload, eventsPending, eventsVoltage, eventsPower);
+    eventsPending = 0;
+    return length;
+}
@@ -0,0 +1,630 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+#pragma once
+
+/* Includes */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ *  Fragmented firmware update over downlinks (FUOTA)
+ *
+ *  The image is cut by the server into M fragments of fragSize bytes and sent
+ *  on FUOTA_PORT, followed by coded fragments. A coded fragment is the XOR of
+ *  about M/2 fragments chosen by the parity generator of the LoRa Alliance
+ *  Fragmented Data Block Transport (TS004), so any lost fragment can be rebuilt
+ *  from enough coded ones, whichever they are.
+ *
+ *  Nothing is buffered in RAM: plain fragments are written at their place in the
+ *  staging area, coded fragments are reduced against the fragments already in
+ *  flash and appended to a scratch area after the image. Only the GF(2) matrix
+ *  of the lost fragments and the map of the received ones live in RAM, about
+ *  2 x FUOTA_MAX_MISSING^2 / 8 + FUOTA_MAX_FRAGMENTS / 4 bytes, allocated by
+ *  the setup command and freed when the session ends.
+ *  When every fragment is known the image CRC32 is checked and the staging
+ *  partition is marked for boot, the swap happens on the next reset.
+ *
+ *  The slow parts (erasing the staging area, rebuilding the lost fragments,
+ *  the CRC of the whole image) never run inside the downlink handler: they
+ *  set an ERASING, SOLVING or VERIFYING state and the caller runs fuotaWork()
+ *  from a job, one sector of flash per call, while fuotaBusy().
+ *  Fragments are ignored while erasing, the status uplink tells the server
+ *  when to start.
+ *
+ *  Downlinks on FUOTA_PORT (integers big endian):
+ *    01 | fragSize (1) | image size (4) | CRC32 (4)   Session setup, erases the staging area
+ *    02                                               Status request
+ *    03                                               Apply, reboots into the new image once COMPLETE
+ *    08 | index (2) | data (fragSize)                 Fragment, 1..M plain, M+1.. coded
+ *
+ *  Status uplink on FUOTA_PORT: | state (1) | received (2) | missing (2) |
+ *
+ *  The staging area is the next OTA partition on ESP32. Define FUOTA_FLASH_CUSTOM
+ *  and provide the fuotaFlash* functions to stage somewhere else (external flash,
+ *  host build, see tests/test_fuota.cpp); this file has no Arduino or LMiC
+ *  dependencies otherwise.
+ */
+
+/* Definitions */
+#define FUOTA_CMD_SETUP             0x01
+#define FUOTA_CMD_STATUS            0x02
+#define FUOTA_CMD_APPLY             0x03
+#define FUOTA_CMD_FRAGMENT          0x08
+
+#define FUOTA_IDLE                  0
+#define FUOTA_RECEIVING             1
+#define FUOTA_COMPLETE              2       /* Verified, staging partition marked for boot */
+#define FUOTA_ERROR_SETUP           3       /* Bad setup or image larger than the staging area */
+#define FUOTA_ERROR_LOSS            4       /* More lost fragments than FUOTA_MAX_MISSING */
+#define FUOTA_ERROR_FLASH           5
+#define FUOTA_ERROR_CRC             6
+#define FUOTA_APPLY                 7       /* Returned by fuotaDownlink(), the caller reboots */
+#define FUOTA_ERASING               8       /* fuotaWork() pending */
+#define FUOTA_SOLVING               9       /* fuotaWork() pending */
+#define FUOTA_VERIFYING             10      /* fuotaWork() pending */
+
+#define FUOTA_SECTOR_SIZE           4096
+#define FUOTA_ROW_BYTES             ((FUOTA_MAX_MISSING + 7) / 8)
+
+/* Types */
+/* Allocated for the length of a session only */
+typedef struct
+{
+    uint8_t   receivedMap[FUOTA_MAX_FRAGMENTS / 8];
+    uint8_t   parity[FUOTA_MAX_FRAGMENTS / 8];                  /* Parity row over the M fragments */
+    uint16_t  missing[FUOTA_MAX_MISSING];                       /* Lost fragments, columns of the matrix */
+
+    /* Reduced row echelon form, row k is stored at scratch slot k */
+    uint16_t  pivot[FUOTA_MAX_MISSING];
+    uint8_t   rows[FUOTA_MAX_MISSING][FUOTA_ROW_BYTES];         /* Over the lost fragments */
+    uint8_t   combination[FUOTA_MAX_MISSING][FUOTA_ROW_BYTES];  /* Over the scratch slots */
+} fuotaBuffers_t;
+
+typedef struct
+{
+    uint8_t   state;
+    uint8_t   fragSize;
+    uint16_t  fragments;                /* M */
+    uint32_t  imageSize;
+    uint32_t  imageCrc;
+    uint32_t  scratchOffset;            /* Coded fragments, after the image */
+    uint32_t  eraseSize;
+
+    uint16_t  received;                 /* Plain fragments written in place */
+
+    /* Lost fragments, frozen when the first coded fragment arrives */
+    bool      frozen;
+    uint16_t  missingCount;             /* L */
+    uint16_t  rank;
+
+    /* Progress of fuotaWork() */
+    uint32_t  workOffset;               /* ERASING, VERIFYING: bytes done */
+    uint16_t  workRow;                  /* SOLVING: rows written */
+    uint16_t  workSlot;                 /* SOLVING: scratch slots of the row XORed */
+    uint32_t  workCrc;
+
+    /* Counters, also useful to size the redundancy on the server */
+    uint16_t  coded;
+    uint16_t  codedUseless;
+} fuotaSession_t;
+
+/* Variables */
+fuotaSession_t  fuota;
+fuotaBuffers_t *fuotaBuffers = NULL;
+
+uint8_t  fuotaRow[FUOTA_ROW_BYTES];
+uint8_t  fuotaCombination[FUOTA_ROW_BYTES];
+uint8_t  fuotaData[FUOTA_MAX_FRAGMENT_SIZE];
+uint8_t  fuotaRead[FUOTA_MAX_FRAGMENT_SIZE];
+
+/* Staging area */
+#ifndef FUOTA_FLASH_CUSTOM
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+
+const esp_partition_t *fuotaPartition = NULL;
+
+/* Staging area of at least size bytes */
+bool fuotaFlashBegin(uint32_t size)
+{
+    fuotaPartition = esp_ota_get_next_update_partition(NULL);
+    return fuotaPartition != NULL && size <= fuotaPartition->size;
+}
+
+/* offset and len are multiples of FUOTA_SECTOR_SIZE */
+bool fuotaFlashErase(uint32_t offset, uint32_t len)
+{
+    return esp_partition_erase_range(fuotaPartition, offset, len) == ESP_OK;
+}
+
+bool fuotaFlashWrite(uint32_t offset, const uint8_t *data, uint32_t len)
+{
+    return esp_partition_write(fuotaPartition, offset, data, len) == ESP_OK;
+}
+
+bool fuotaFlashRead(uint32_t offset, uint8_t *data, uint32_t len)
+{
+    return esp_partition_read(fuotaPartition, offset, data, len) == ESP_OK;
+}
+
+/* Also validates the image header and checksum */
+bool fuotaFlashActivate()
+{
+    return esp_ota_set_boot_partition(fuotaPartition) == ESP_OK;
+}
+#endif
+
+/* Functions */
+/* CRC-32 (IEEE 802.3), same as zlib/crc32 of the image file */
+uint32_t fuotaCrc32(uint32_t crc, const uint8_t *data, uint32_t len)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+/* TS004 pseudo random generator */
+uint32_t fuotaPrbs23(uint32_t x)
+{
+    uint32_t b0 = x & 1;
+    uint32_t b1 = (x & 0x20) >> 5;
+    return (x >> 1) + ((b0 ^ b1) << 22);
+}
+
+/* TS004 parity row of coded fragment n (1, 2, ...) over m fragments, into fuotaBuffers->parity */
+void fuotaParityRow(uint16_t n, uint16_t m)
+{
+    uint32_t x = 1 + 1001UL * n;
+    uint16_t extra = ((m & (m - 1)) == 0) ? 1 : 0;  /* m is a power of two */
+
+    memset(fuotaBuffers->parity, 0, (m + 7) / 8);
+    for (uint16_t coeff = 0; coeff < m / 2; coeff++)
+    {
+        uint32_t r = 1UL << 16;
+        while (r >= m)
+        {
+            x = fuotaPrbs23(x);
+            r = x % (m + extra);
+        }
+        fuotaBuffers->parity[r >> 3] |= 1 << (r & 7);
+    }
+}
+
+bool fuotaBit(const uint8_t *bits, uint16_t i)
+{
+    return (bits[i >> 3] >> (i & 7)) & 1;
+}
+
+void fuotaXor(uint8_t *to, const uint8_t *from, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++)
+    {
+        to[i] ^= from[i];
+    }
+}
+
+/* Column of a lost fragment, -1 if the fragment is known */
+int32_t fuotaColumn(uint16_t fragment)
+{
+    uint16_t low = 0, high = fuota.missingCount;
+
+    while (low < high)
+    {
+        uint16_t middle = (low + high) / 2;
+        if (fuotaBuffers->missing[middle] < fragment)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return (low < fuota.missingCount && fuotaBuffers->missing[low] == fragment) ? low : -1;
+}
+
+/* Lost fragments become the columns of the matrix */
+bool fuotaFreeze()
+{
+    fuota.frozen = true;
+    fuota.missingCount = 0;
+    for (uint16_t i = 0; i < fuota.fragments; i++)
+    {
+        if (!fuotaBit(fuotaBuffers->receivedMap, i))
+        {
+            if (fuota.missingCount == FUOTA_MAX_MISSING)
+            {
+                return false;
+            }
+            fuotaBuffers->missing[fuota.missingCount++] = i;
+        }
+    }
+    return true;
+}
+
+/*
+ *  Adds the equation fuotaRow (over the lost fragments) = fuotaData to the
+ *  matrix, keeping it in reduced row echelon form. Equations that bring no
+ *  new information are dropped before touching the flash.
+ */
+uint8_t fuotaEquation()
+{
+    memset(fuotaCombination, 0, FUOTA_ROW_BYTES);
+    fuotaCombination[fuota.rank >> 3] |= 1 << (fuota.rank & 7);
+
+    for (uint16_t k = 0; k < fuota.rank; k++)
+    {
+        if (fuotaBit(fuotaRow, fuotaBuffers->pivot[k]))
+        {
+            fuotaXor(fuotaRow, fuotaBuffers->rows[k], FUOTA_ROW_BYTES);
+            fuotaXor(fuotaCombination, fuotaBuffers->combination[k], FUOTA_ROW_BYTES);
+        }
+    }
+
+    int32_t pivot = -1;
+    for (uint16_t column = 0; column < fuota.missingCount; column++)
+    {
+        if (fuotaBit(fuotaRow, column))
+        {
+            pivot = column;
+            break;
+        }
+    }
+    if (pivot < 0)
+    {
+        fuota.codedUseless++;
+        return FUOTA_RECEIVING;
+    }
+
+    if (!fuotaFlashWrite(fuota.scratchOffset + (uint32_t)fuota.rank * fuota.fragSize, fuotaData, fuota.fragSize))
+    {
+        return FUOTA_ERROR_FLASH;
+    }
+
+    /* Clears the new pivot from the other rows */
+    for (uint16_t k = 0; k < fuota.rank; k++)
+    {
+        if (fuotaBit(fuotaBuffers->rows[k], pivot))
+        {
+            fuotaXor(fuotaBuffers->rows[k], fuotaRow, FUOTA_ROW_BYTES);
+            fuotaXor(fuotaBuffers->combination[k], fuotaCombination, FUOTA_ROW_BYTES);
+        }
+    }
+    memcpy(fuotaBuffers->rows[fuota.rank], fuotaRow, FUOTA_ROW_BYTES);
+    memcpy(fuotaBuffers->combination[fuota.rank], fuotaCombination, FUOTA_ROW_BYTES);
+    fuotaBuffers->pivot[fuota.rank] = pivot;
+    fuota.rank++;
+
+    /* Full rank: fuotaWork() writes the lost fragments */
+    return (fuota.rank == fuota.missingCount) ? FUOTA_SOLVING : FUOTA_RECEIVING;
+}
+
+/* Plain fragment index (0 based) */
+uint8_t fuotaPlain(uint16_t index, const uint8_t *data)
+{
+    if (!fuota.frozen)
+    {
+        if (fuotaBit(fuotaBuffers->receivedMap, index))
+        {
+            return FUOTA_RECEIVING;
+        }
+        if (!fuotaFlashWrite((uint32_t)index * fuota.fragSize, data, fuota.fragSize))
+        {
+            return FUOTA_ERROR_FLASH;
+        }
+        fuotaBuffers->receivedMap[index >> 3] |= 1 << (index & 7);
+        fuota.received++;
+        return (fuota.received == fuota.fragments) ? FUOTA_VERIFYING : FUOTA_RECEIVING;
+    }
+
+    /* Late fragment of a lost one: an equation with a single unknown */
+    int32_t column = fuotaColumn(index);
+    if (column < 0)
+    {
+        return FUOTA_RECEIVING;
+    }
+    memset(fuotaRow, 0, FUOTA_ROW_BYTES);
+    fuotaRow[column >> 3] |= 1 << (column & 7);
+    memcpy(fuotaData, data, fuota.fragSize);
+    return fuotaEquation();
+}
+
+/* Coded fragment n (1, 2, ...) */
+uint8_t fuotaCoded(uint16_t n, const uint8_t *data)
+{
+    fuota.coded++;
+    if (!fuota.frozen && !fuotaFreeze())
+    {
+        return FUOTA_ERROR_LOSS;
+    }
+
+    /* Known fragments are XORed out, what remains only depends on the lost ones */
+    fuotaParityRow(n, fuota.fragments);
+    memset(fuotaRow, 0, FUOTA_ROW_BYTES);
+    memcpy(fuotaData, data, fuota.fragSize);
+    for (uint16_t i = 0; i < fuota.fragments; i++)
+    {
+        if (!fuotaBit(fuotaBuffers->parity, i))
+        {
+            continue;
+        }
+        int32_t column = fuotaColumn(i);
+        if (column >= 0)
+        {
+            fuotaRow[column >> 3] |= 1 << (column & 7);
+        }
+        else
+        {
+            if (!fuotaFlashRead((uint32_t)i * fuota.fragSize, fuotaRead, fuota.fragSize))
+            {
+                return FUOTA_ERROR_FLASH;
+            }
+            fuotaXor(fuotaData, fuotaRead, fuota.fragSize);
+        }
+    }
+    return fuotaEquation();
+}
+
+/* Starts a new session, any previous one is dropped. The staging area is erased by fuotaWork() */
+uint8_t fuotaSetup(uint8_t fragSize, uint32_t imageSize, uint32_t imageCrc)
+{
+    memset(&fuota, 0, sizeof(fuota));
+    fuota.fragSize  = fragSize;
+    fuota.imageSize = imageSize;
+    fuota.imageCrc  = imageCrc;
+
+    if (fragSize == 0 || fragSize > FUOTA_MAX_FRAGMENT_SIZE || imageSize == 0
+        || (imageSize + fragSize - 1) / fragSize > FUOTA_MAX_FRAGMENTS)
+    {
+        return FUOTA_ERROR_SETUP;
+    }
+    fuota.fragments     = (imageSize + fragSize - 1) / fragSize;
+    fuota.scratchOffset = ((uint32_t)fuota.fragments * fragSize + FUOTA_SECTOR_SIZE - 1) & ~(uint32_t)(FUOTA_SECTOR_SIZE - 1);
+    fuota.eraseSize     = (fuota.scratchOffset + (uint32_t)FUOTA_MAX_MISSING * fragSize + FUOTA_SECTOR_SIZE - 1) & ~(uint32_t)(FUOTA_SECTOR_SIZE - 1);
+
+    if (!fuotaFlashBegin(fuota.eraseSize))
+    {
+        return FUOTA_ERROR_SETUP;
+    }
+
+    if (fuotaBuffers == NULL)
+    {
+        fuotaBuffers = (fuotaBuffers_t *)malloc(sizeof(fuotaBuffers_t));
+        if (fuotaBuffers == NULL)
+        {
+            return FUOTA_ERROR_SETUP;
+        }
+    }
+    memset(fuotaBuffers->receivedMap, 0, sizeof(fuotaBuffers->receivedMap));
+    return FUOTA_ERASING;
+}
+
+/* Work left for fuotaWork() */
+bool fuotaBusy()
+{
+    return fuota.state == FUOTA_ERASING || fuota.state == FUOTA_SOLVING || fuota.state == FUOTA_VERIFYING;
+}
+
+/* Frees the session buffers once the session is over */
+void fuotaRelease()
+{
+    if (fuota.state != FUOTA_RECEIVING && !fuotaBusy() && fuotaBuffers != NULL)
+    {
+        free(fuotaBuffers);
+        fuotaBuffers = NULL;
+    }
+}
+
+/*
+ *  Lost fragment workRow is the XOR of the scratch slots of its row, summed in
+ *  fuotaData (free, no fragment is taken while SOLVING) a sector of reads at a
+ *  time, then written in place.
+ */
+uint8_t fuotaSolveRow()
+{
+    uint16_t k = fuota.workRow;
+    uint32_t read = 0;
+
+    if (fuota.workSlot == 0)
+    {
+        memset(fuotaData, 0, fuota.fragSize);
+    }
+    for (; fuota.workSlot < fuota.rank; fuota.workSlot++)
+    {
+        if (fuotaBit(fuotaBuffers->combination[k], fuota.workSlot))
+        {
+            if (read + fuota.fragSize > FUOTA_SECTOR_SIZE)
+            {
+                return FUOTA_SOLVING;
+            }
+            if (!fuotaFlashRead(fuota.scratchOffset + (uint32_t)fuota.workSlot * fuota.fragSize, fuotaRead, fuota.fragSize))
+            {
+                return FUOTA_ERROR_FLASH;
+            }
+            fuotaXor(fuotaData, fuotaRead, fuota.fragSize);
+            read += fuota.fragSize;
+        }
+    }
+    fuota.workSlot = 0;
+
+    uint16_t fragment = fuotaBuffers->missing[fuotaBuffers->pivot[k]];
+    if (!fuotaFlashWrite((uint32_t)fragment * fuota.fragSize, fuotaData, fuota.fragSize))
+    {
+        return FUOTA_ERROR_FLASH;
+    }
+
+    if (++fuota.workRow < fuota.rank)
+    {
+        return FUOTA_SOLVING;
+    }
+    fuota.received = fuota.fragments;
+    return FUOTA_VERIFYING;
+}
+
+/* CRC of the next sector of the image, then marks it for boot */
+uint8_t fuotaVerifySector()
+{
+    uint32_t end = fuota.workOffset + FUOTA_SECTOR_SIZE;
+    if (end > fuota.imageSize)
+    {
+        end = fuota.imageSize;
+    }
+
+    while (fuota.workOffset < end)
+    {
+        uint32_t len = end - fuota.workOffset;
+        if (len > FUOTA_MAX_FRAGMENT_SIZE)
+        {
+            len = FUOTA_MAX_FRAGMENT_SIZE;
+        }
+        if (!fuotaFlashRead(fuota.workOffset, fuotaRead, len))
+        {
+            return FUOTA_ERROR_FLASH;
+        }
+        fuota.workCrc     = fuotaCrc32(fuota.workCrc, fuotaRead, len);
+        fuota.workOffset += len;
+    }
+
+    if (fuota.workOffset < fuota.imageSize)
+    {
+        return FUOTA_VERIFYING;
+    }
+    if (fuota.workCrc != fuota.imageCrc)
+    {
+        return FUOTA_ERROR_CRC;
+    }
+    return fuotaFlashActivate() ? FUOTA_COMPLETE : FUOTA_ERROR_FLASH;
+}
+
+/*
+ *  One bounded step of the slow work: one sector erased, read for a lost
+ *  fragment or added to the image CRC. Returns true while fuotaBusy().
+ */
+bool fuotaWork()
+{
+    uint8_t previous = fuota.state;
+
+    switch (fuota.state)
+    {
+    case FUOTA_ERASING:
+        if (!fuotaFlashErase(fuota.workOffset, FUOTA_SECTOR_SIZE))
+        {
+            fuota.state = FUOTA_ERROR_FLASH;
+            break;
+        }
+        fuota.workOffset += FUOTA_SECTOR_SIZE;
+        if (fuota.workOffset >= fuota.eraseSize)
+        {
+            fuota.state = FUOTA_RECEIVING;
+        }
+        break;
+    case FUOTA_SOLVING:
+        fuota.state = fuotaSolveRow();
+        break;
+    case FUOTA_VERIFYING:
+        fuota.state = fuotaVerifySector();
+        break;
+    default:
+        return false;
+    }
+
+    if (fuota.state != previous)
+    {
+        fuota.workOffset = 0;
+        fuota.workCrc    = 0;
+    }
+    fuotaRelease();
+    return fuotaBusy();
+}
+
+/* Fragments still unknown */
+uint16_t fuotaMissing()
+{
+    if (fuota.state == FUOTA_COMPLETE)
+    {
+        return 0;
+    }
+    return fuota.frozen ? fuota.missingCount - fuota.rank : fuota.fragments - fuota.received;
+}
+
+/* Handles a downlink on FUOTA_PORT, returns the session state or FUOTA_APPLY */
+uint8_t fuotaDownlink(const uint8_t *data, uint8_t len)
+{
+    if (len == 10 && data[0] == FUOTA_CMD_SETUP)
+    {
+        uint32_t size = ((uint32_t)data[2] << 24) | ((uint32_t)data[3] << 16) | ((uint32_t)data[4] << 8) | data[5];
+        uint32_t crc  = ((uint32_t)data[6] << 24) | ((uint32_t)data[7] << 16) | ((uint32_t)data[8] << 8) | data[9];
+        fuota.state = fuotaSetup(data[1], size, crc);
+    }
+    else if (len == 1 && data[0] == FUOTA_CMD_APPLY && fuota.state == FUOTA_COMPLETE)
+    {
+        return FUOTA_APPLY;
+    }
+    else if (len >= 3 && data[0] == FUOTA_CMD_FRAGMENT && fuota.state == FUOTA_RECEIVING
+             && len - 3 == fuota.fragSize)
+    {
+        uint16_t index = ((uint16_t)data[1] << 8) | data[2];
+        if (index >= 1 && index <= fuota.fragments)
+        {
+            fuota.state = fuotaPlain(index - 1, data + 3);
+        }
+        else if (index > fuota.fragments)
+        {
+            fuota.state = fuotaCoded(index - fuota.fragments, data + 3);
+        }
+    }
+    fuotaRelease();
+    return fuota.state;
+}
@@ -0,0 +1,239 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+#pragma once
+
+/* Includes */
+#include <lmic.h>
+#include "_airtime.h"
+
+/*
+ *  Join Scheduler (OTAA)
+ *  
+ *  Left alone, LMiC starts joining as soon as the node boots and keeps retrying
+ *  on its own, so after a power restoration the whole fleet hits the gateway in
+ *  the same second and keeps colliding. Here joins go in rounds:
+ *  
+ *  - the first round starts at a random time within JOIN_INITIAL_WINDOW_MS;
+ *  - a round is at most JOIN_ATTEMPTS_PER_ROUND join requests, then LMiC is
+ *    stopped (LMIC_reset) until the next round;
+ *  - round n waits between half and all of JOIN_BACKOFF_BASE_MS x 2^n, capped
+ *    at JOIN_BACKOFF_MAX_MS;
+ *  - round n starts at JOIN_DR_FASTEST - n, down to JOIN_DR_SLOWEST, so nodes
+ *    close to the gateway get in with short frames and far ones still do later;
+ *  - each round starts on the next enabled 125 kHz channel (0 at 63), the
+ *    first one on USE_CHANNEL_START_JOINING when defined; channels 64 at 71
+ *    are BW500, DR6 only, and the rounds use DR5..DR2;
+ *  - join requests draw from an airtime budget of JOIN_AIRTIME_BUDGET_MS per
+ *    hour, a round only starts when a whole round fits in it.
+ *  
+ *  The trade-off is join time for airtime: in the mass rejoin of
+ *  tests/test_join.cpp (500 nodes, one 8 channel gateway) every node joins
+ *  with less than half the join requests of LMiC left alone, none of them on
+ *  a 500 kHz channel, but the pauses between rounds make the slow nodes
+ *  later (p50 52 s against 50 s, p90 105 s against 84 s). It does not make
+ *  the fleet join faster.
+ */
+
+/* Definitions */
+#define JOIN_REQUEST_LENGTH         23      /* MHDR (1) + AppEUI (8) + DevEUI (8) + DevNonce (2) + MIC (4) */
+#define JOIN_HOUR_MS                3600000UL
+#define JOIN_CHANNELS               64      /* 125 kHz channels, the BW500 ones come after */
+
+/* Variables */
+u1_t  joinRound         = 0;        /* Rounds failed in a row */
+u1_t  joinAttempts      = 0;        /* Join requests in the current round */
+bool  joinPaused        = false;    /* Between two rounds */
+u1_t  joinChannel       = 0xFF;     /* Channel of the current round */
+u4_t  joinAirtimeTokens = JOIN_AIRTIME_BUDGET_MS;
+u4_t  joinAirtimeLast   = 0;
+
+/* Functions */
+/* Nodes of the same batch should not share a random sequence */
+void joinBegin()
+{
+    u1_t devEui[8];
+    u4_t seed = micros();
+
+    os_getDevEui(devEui);
+    for (u1_t i = 0; i < 8; i++)
+    {
+        seed = seed * 31 + devEui[i];
+    }
+    randomSeed(seed);
+}
+
+u4_t joinInitialDelayMs()
+{
+    return random(JOIN_INITIAL_WINDOW_MS);
+}
+
+/* Refills the airtime budget, JOIN_AIRTIME_BUDGET_MS per hour */
+void joinAirtimeRefill(u4_t nowMs)
+{
+    u4_t elapsed = nowMs - joinAirtimeLast;
+    joinAirtimeLast = nowMs;
+
+    u4_t refill = (u4_t)((uint64_t)elapsed * JOIN_AIRTIME_BUDGET_MS / JOIN_HOUR_MS);
+    joinAirtimeTokens = (joinAirtimeTokens + refill > JOIN_AIRTIME_BUDGET_MS) ? JOIN_AIRTIME_BUDGET_MS : joinAirtimeTokens + refill;
+}
+
+u1_t joinDataRate()
+{
+    return (joinRound >= JOIN_DR_FASTEST - JOIN_DR_SLOWEST) ? JOIN_DR_SLOWEST : JOIN_DR_FASTEST - joinRound;
+}
+
+/* Airtime of a whole round at the current data rate */
+u4_t joinRoundAirtimeMs()
+{
+    return (u4_t)JOIN_ATTEMPTS_PER_ROUND * airtimeMs(joinDataRate(), JOIN_REQUEST_LENGTH);
+}
+
+/* First channel of the next round, rotating over the enabled 125 kHz channels */
+u1_t joinNextChannel()
+{
+    if (joinChannel == 0xFF)
+    {
+#ifdef USE_CHANNEL_START_JOINING
+        if (USE_CHANNEL_START_JOINING < JOIN_CHANNELS && networkChannelEnabled(USE_CHANNEL_START_JOINING))
+        {
+            joinChannel = USE_CHANNEL_START_JOINING;
+            return joinChannel;
+        }
+#endif
+        joinChannel = random(JOIN_CHANNELS);
+    }
+
+    for (u1_t i = 1; i <= JOIN_CHANNELS; i++)
+    {
+        u1_t channel = (joinChannel + i) % JOIN_CHANNELS;
+        if (networkChannelEnabled(channel))
+        {
+            joinChannel = channel;
+            break;
+        }
+    }
+    return joinChannel;
+}
+
+/* A round starts, returns the data rate to use */
+u1_t joinRoundStart()
+{
+    joinPaused   = false;
+    joinAttempts = 0;
+    return joinDataRate();
+}
+
+/*
+ *  Counts a join request without answer (EV_JOIN_TXCOMPLETE) and charges its
+ *  airtime. Returns true when the round is over and the node must back off.
+ */
+bool joinAttempt(u1_t dr, u4_t nowMs)
+{
+    u4_t cost = airtimeMs(dr, JOIN_REQUEST_LENGTH);
+
+    joinAirtimeRefill(nowMs);
+    joinAirtimeTokens = (joinAirtimeTokens > cost) ? joinAirtimeTokens - cost : 0;
+
+    if (!joinPaused && ++joinAttempts >= JOIN_ATTEMPTS_PER_ROUND)
+    {
+        joinPaused = true;
+        return true;
+    }
+    return false;
+}
+
+/* LMiC gave up on its own (EV_JOIN_FAILED), true if the round was still running */
+bool joinGiveUp()
+{
+    if (joinPaused)
+    {
+        return false;
+    }
+    joinPaused = true;
+    return true;
+}
+
+/* The round failed, returns how long to wait before the next one */
+u4_t joinRoundFailed(u4_t nowMs)
+{
+    u4_t window = JOIN_BACKOFF_BASE_MS;
+    for (u1_t i = 0; i < joinRound && window < JOIN_BACKOFF_MAX_MS; i++)
+    {
+        window *= 2;
+    }
+    if (window > JOIN_BACKOFF_MAX_MS)
+    {
+        window = JOIN_BACKOFF_MAX_MS;
+    }
+
+    if (joinRound < 0xFF)
+    {
+        joinRound++;
+    }
+
+    /* Half the window fixed, half random */
+    u4_t delay = window / 2 + random(window / 2 + 1);
+
+    /* Not before the budget holds a whole round */
+    joinAirtimeRefill(nowMs);
+    u4_t needed = joinRoundAirtimeMs();
+    if (joinAirtimeTokens < needed)
+    {
+        u4_t refillMs = (u4_t)((uint64_t)(needed - joinAirtimeTokens) * JOIN_HOUR_MS / JOIN_AIRTIME_BUDGET_MS);
+        if (delay < refillMs)
+        {
+            delay = refillMs;
+        }
+    }
+    return delay;
+}
+
+void joinSucceeded()
+{
+    joinRound  = 0;
+    joinPaused = false;
+}
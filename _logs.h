@@ -65,6 +65,8 @@ void printHex2(unsigned v)
 
 void showTxRxInformations()
 {
+    PROFILE_SCOPE(PROFILER_LOGS);
+    
     /* 
      *  WARNING: The calculated RSSI and SNR
      *  does not correspond 100% to the NetworkServer RSSI and SNR console values.
@@ -138,6 +140,8 @@ void showTxRxInformations()
 
 void showNetworkInformations()
 {
+    PROFILE_SCOPE(PROFILER_LOGS);
+    
     u4_t netid = 0;
     devaddr_t devaddr = 0;
     u1_t nwkKey[16];
@@ -186,6 +190,8 @@ void showNetworkInformations()
 /* Downlinks Log */
 void downlinksLog()
 {
+    PROFILE_SCOPE(PROFILER_LOGS);
+    
     #ifdef DEBUG
     DEBUG_PORT.println(" [INFO] RX Delay            : " + String(LMIC.rxDelay)); /* Default value 1 */
     DEBUG_PORT.println(" [INFO] Maximum Clock Error : " + String(MAX_CLOCK_ERROR)); /* Default value 65536 */
@@ -307,3 +313,39 @@ void downlinksLog()
         #endif
     }
 }
+
+/* AES Log */
+void showAesInformations()
+{
+    PROFILE_SCOPE(PROFILER_LOGS);
+    
+    uint8_t key[16]   = {0};
+    uint8_t block[16] = {0};
+    bool    passed    = aesSelfTest();
+
+    #ifdef DEBUG
+    DEBUG_PORT.println(F("****************************************************"));
+    DEBUG_PORT.println(" [INFO] AES Self Test       : " + String(passed ? "PASSED" : "FAILED <<< "));
+    #endif
+
+    /* Time per block of each backend, first call outside the measure (tables and key setup) */
+    for (uint8_t i = 0; i < AES_BACKENDS_COUNT; i++)
+    {
+        aesBackends[i].encrypt(key, block, block);
+
+        unsigned long start = micros();
+        for (uint16_t n = 0; n < 1000; n++)
+        {
+            aesBackends[i].encrypt(key, block, block);
+        }
+        unsigned long elapsed = micros() - start;
+
+        #ifdef DEBUG
+        DEBUG_PORT.println(" [INFO] AES ns/block        : " + String(elapsed) + " (" + String(aesBackends[i].name) + ")");
+        #endif
+    }
+
+    #ifdef DEBUG
+    DEBUG_PORT.println(F("****************************************************"));
+    #endif
+}
@@ -0,0 +1,115 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+#pragma once
+
+/* Includes */
+#include <lmic.h>
+#include <PZEM004Tv30.h>    /* https://github.com/mandulaj/PZEM-004T-v30 */
+#ifdef USE_DUAL_CORE
+#include "_spsc.h"
+#endif
+
+/*
+ *  Peacefair PZEM-004T 3.0 (Modbus-RTU over TTL)
+ *  
+ *  The library hands out floats, they are converted once here to the
+ *  integer units below so everything after the read (event detection,
+ *  energy accumulator, payloads) is fixed-point.
+ */
+
+/* Types */
+typedef struct
+{
+    bool valid;
+    u2_t voltage;       /* 0.1 V */
+    u4_t current;       /* mA */
+    u4_t power;         /* 0.1 W */
+    u4_t energy;        /* Wh, cumulative counter of the meter */
+    u2_t frequency;     /* 0.1 Hz */
+    u1_t pf;            /* 0.01 */
+} meterReading_t;
+
+/* Instances */
+#if defined(ARDUINO_ARCH_ESP32)
+PZEM004Tv30 pzem(PZEM_SERIAL, PZEM_RX_GPIO, PZEM_TX_GPIO);
+#else
+PZEM004Tv30 pzem(PZEM_SERIAL);
+#endif
+
+/* Variables */
+meterReading_t meterReading;
+#ifdef USE_DUAL_CORE
+spscQueue<meterReading_t, METER_QUEUE_SIZE> meterQueue;    /* metertask() -> samplefunc() */
+#endif
+
+/* Functions */
+/*
+ *  One Modbus transaction (the library caches the 10 registers), returns
+ *  false if the meter did not answer, e.g. no voltage on its input.
+ */
+bool meterRead(meterReading_t *reading)
+{
+    float voltage = pzem.voltage();
+
+    reading->valid = !isnan(voltage);
+    if (!reading->valid)
+    {
+        /* The PZEM is powered by the measured line, no answer means outage */
+        reading->voltage = 0;
+        reading->current = 0;
+        reading->power   = 0;
+        return false;
+    }
+
+    reading->voltage   = (u2_t)(voltage * 10.0f + 0.5f);
+    reading->current   = (u4_t)(pzem.current() * 1000.0f + 0.5f);
+    reading->power     = (u4_t)(pzem.power() * 10.0f + 0.5f);
+    reading->energy    = (u4_t)(pzem.energy() * 1000.0f + 0.5f);
+    reading->frequency = (u2_t)(pzem.frequency() * 10.0f + 0.5f);
+    reading->pf        = (u1_t)(pzem.pf() * 100.0f + 0.5f);
+    return true;
+}
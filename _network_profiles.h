@@ -0,0 +1,232 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+#pragma once
+
+/* Includes */
+#include <lmic.h>
+
+/*
+ *  Network Profiles
+ *  
+ *  Everything that used to depend on USE_CHIRPSTACK_AU915, USE_CHIRPSTACK_AU915LA,
+ *  USE_EVERYNET_AU915LA and USE_THETHINGSNETWORK_AU915 is now a row of
+ *  networkProfiles[] (radio) plus the same index in the key tables of
+ *  _credentials.h, so the network is chosen at runtime.
+ *  
+ *  The node boots on NETWORK_PRIMARY (or on the active profile of the
+ *  credentials store) and, in OTAA, moves to the next network after
+ *  NETWORK_FAILOVER_JOIN_FAILURES consecutive EV_JOIN_FAILED.
+ */
+
+/* Types */
+typedef struct
+{
+    u1_t channelMask[9];    /* Channels 0 at 71, channel n = bit (n % 8) of byte (n / 8) */
+    u1_t dn2Dr;             /* RX2 data rate */
+    u1_t rxDelay;           /* RX1 delay in seconds */
+} networkProfile_t;
+
+/* Profiles, indexed by NETWORK_* (see _configurations.h) */
+static const networkProfile_t PROGMEM networkProfiles[NETWORKS_COUNT] = {
+    /* ChirpStack AU915 (8 at 15 + 65 channels) */
+    {{0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02}, DN2DR, RX_DELAY},
+    /* ChirpStack AU915LA (0 at 7 + 64 channels) */
+    {{0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01}, DN2DR, RX_DELAY},
+    /* Rede ATC (Everynet) AU915LA (0 at 7 channels) */
+    {{0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, DN2DR, RX_DELAY},
+    /* Rede TTN AU915 (8 at 15 + 65 channels) */
+    {{0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02}, DN2DR, RX_DELAY}
+};
+
+/* Variables */
+u1_t              networkCurrent        = NETWORK_PRIMARY;
+networkProfile_t  networkProfile;       /* RAM copy of networkProfiles[networkCurrent] */
+u1_t              networkJoinFailures   = 0;
+
+/* Functions */
+void networkSelect(u1_t network)
+{
+    if (network >= NETWORKS_COUNT)
+    {
+        network = NETWORK_PRIMARY;
+    }
+    networkCurrent = network;
+    memcpy_P(&networkProfile, &networkProfiles[network], sizeof(networkProfile_t));
+}
+
+/* Network of the credentials store when there is one, NETWORK_PRIMARY otherwise */
+void networkBegin()
+{
+#ifdef USE_CREDENTIALS_STORE
+    if (credentialsProfile() != NULL)
+    {
+        networkSelect(credentialsProfile()->network);
+        return;
+    }
+#endif
+    networkSelect(NETWORK_PRIMARY);
+}
+
+bool networkChannelEnabled(u1_t channel)
+{
+    return (networkProfile.channelMask[channel / 8] >> (channel % 8)) & 0x01;
+}
+
+/*
+ *  Counts one EV_JOIN_FAILED and returns true when it is time to move to the
+ *  next network. In RAM only: after a reboot the node starts on the primary
+ *  network (or on the stored profile) again.
+ */
+bool networkJoinFailed()
+{
+    if (NETWORK_FAILOVER_JOIN_FAILURES == 0 || ++networkJoinFailures < NETWORK_FAILOVER_JOIN_FAILURES)
+    {
+        return false;
+    }
+    networkJoinFailures = 0;
+
+#ifdef USE_CREDENTIALS_STORE
+    if (credentialsProfile() != NULL)
+    {
+        if (credentialsRecord.profileCount < 2)
+        {
+            return false;
+        }
+        credentialsRecord.activeProfile = (credentialsRecord.activeProfile + 1) % credentialsRecord.profileCount;
+        networkSelect(credentialsProfile()->network);
+        return true;
+    }
+#endif
+
+    if (NETWORK_PRIMARY == NETWORK_BACKUP)
+    {
+        return false;
+    }
+    networkSelect(networkCurrent == NETWORK_PRIMARY ? NETWORK_BACKUP : NETWORK_PRIMARY);
+    return true;
+}
+
+void networkJoined()
+{
+    networkJoinFailures = 0;
+}
+
+/* Activation by Personalization (ABP) session of the current network */
+void networkSetSession()
+{
+#ifdef USE_ABP
+#ifdef USE_CREDENTIALS_STORE
+    const credentialsProfile_t *profile = credentialsProfile();
+    if (profile != NULL)
+    {
+        u4_t devaddr = ((u4_t)profile->devAddr[0] << 24) | ((u4_t)profile->devAddr[1] << 16) | ((u4_t)profile->devAddr[2] << 8) | (u4_t)profile->devAddr[3];
+        u1_t nwkskey[16];
+        u1_t appskey[16];
+        memcpy(nwkskey, profile->nwkSKey, sizeof(nwkskey));
+        memcpy(appskey, profile->appSKey, sizeof(appskey));
+        LMIC_setSession(0x1, devaddr, nwkskey, appskey);
+        return;
+    }
+#endif
+    /*
+     *  On AVR, these values are stored in flash and only copied to RAM once.
+     *  Copy them to a temporary buffer here, LMIC_setSession will.
+     *  Copy them into a buffer of its own again.
+     */
+    uint8_t appskey[16];
+    uint8_t nwkskey[16];
+    memcpy_P(appskey, APPSKEY[networkCurrent], sizeof(appskey));
+    memcpy_P(nwkskey, NWKSKEY[networkCurrent], sizeof(nwkskey));
+    LMIC_setSession(0x1, DEVADDR[networkCurrent], nwkskey, appskey);
+#endif
+}
+
+/* LMiC callbacks, only used in over-the-air activation */
+#ifdef USE_OTAA
+void os_getArtEui(u1_t *buf)
+{
+#ifdef USE_CREDENTIALS_STORE
+    if (credentialsProfile() != NULL)
+    {
+        memcpy(buf, credentialsProfile()->appEui, 8);
+        return;
+    }
+#endif
+    memcpy_P(buf, APPEUI[networkCurrent], 8);
+}
+
+void os_getDevEui(u1_t *buf)
+{
+#ifdef USE_CREDENTIALS_STORE
+    if (credentialsProfile() != NULL)
+    {
+        memcpy(buf, credentialsProfile()->devEui, 8);
+        return;
+    }
+#endif
+    memcpy_P(buf, DEVEUI[networkCurrent], 8);
+}
+
+void os_getDevKey(u1_t *buf)
+{
+#ifdef USE_CREDENTIALS_STORE
+    if (credentialsProfile() != NULL)
+    {
+        memcpy(buf, credentialsProfile()->appKey, 16);
+        return;
+    }
+#endif
+    memcpy_P(buf, APPKEY[networkCurrent], 16);
+}
+#else
+// These callbacks are only used in over-the-air activation, so they are
+// left empty here (we cannot leave them out completely unless
+// DISABLE_JOIN is set in config.h, otherwise the linker will complain).
+void os_getArtEui(u1_t *buf) {}
+void os_getDevEui(u1_t *buf) {}
+void os_getDevKey(u1_t *buf) {}
+#endif
@@ -0,0 +1,501 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+#pragma once
+
+/* Includes */
+#include <stdint.h>
+#include <string.h>
+#include "_crypto.h"
+
+/*
+ *  Network Server stand-in
+ *
+ *  A minimal in-process LoRaWAN 1.0.x network server used to exercise the
+ *  join and downlink paths (EV_JOINED, FPort 255 commands, relay command 101)
+ *  without a live ChirpStack or TTN instance. It runs on a virtual clock in
+ *  milliseconds, it has no Arduino or LMiC dependencies and it is not included
+ *  by the sketch, so it can be compiled into a host build next to the node code.
+ *  Everything is static: each translation unit including it gets its own server.
+ *
+ *  Typical flow driven by the host harness:
+ *
+ *    networkServerInit(appEui, devEui, appKey, RX_DELAY);  <-- same bytes as os_getArtEui/os_getDevEui/os_getDevKey
+ *    networkServerUplink(frame, len, txEndMs);             <-- every frame the radio "transmits"
+ *    networkServerRxWindow(rx1OpenMs, buffer);             <-- when the node opens RX1
+ *    networkServerRxWindow(rx2OpenMs, buffer);             <-- when the node opens RX2 (if RX1 got nothing)
+ *    networkServerQueueDownlink(255, command, 5, false);   <-- application downlinks, sent after the next uplink
+ *
+ *  tests/test_sketch.cpp hands networkServerUplink and networkServerRxWindow
+ *  to the LMiC model (lmicMockConnect), so the whole sketch joins and takes
+ *  its downlinks through this server.
+ */
+
+/* Definitions */
+#define NS_MAX_FRAME                64
+#define NS_DOWNLINK_QUEUE_SIZE      4
+#define NS_JOIN_ACCEPT_DELAY1_MS    5000    /* LoRaWAN default JOIN_ACCEPT_DELAY1 */
+#define NS_JOIN_ACCEPT_DELAY2_MS    6000    /* LoRaWAN default JOIN_ACCEPT_DELAY2 */
+#define NS_RX_WINDOW_TOLERANCE_MS   20      /* Accepted window opening error, see CLOCK_ERROR */
+#define NS_NETID                    0x000000
+#define NS_DEVADDR_BASE             0x26000000
+#define NS_RX2_DATA_RATE            8       /* AU915 RX2: DR8 (SF12BW500) */
+
+/* MHDR message types */
+#define NS_MTYPE_JOIN_REQUEST       0x00
+#define NS_MTYPE_JOIN_ACCEPT        0x20
+#define NS_MTYPE_UNCONFIRMED_UP     0x40
+#define NS_MTYPE_UNCONFIRMED_DOWN   0x60
+#define NS_MTYPE_CONFIRMED_UP       0x80
+#define NS_MTYPE_CONFIRMED_DOWN     0xA0
+
+/* FCtrl bits */
+#define NS_FCTRL_ADR                0x80
+#define NS_FCTRL_ACK                0x20
+
+/* Results of networkServerUplink() */
+#define NS_UPLINK_OK                0
+#define NS_UPLINK_JOINED            1
+#define NS_UPLINK_MIC_ERROR         2
+#define NS_UPLINK_UNKNOWN_DEVICE    3
+#define NS_UPLINK_REPLAY            4
+#define NS_UPLINK_MALFORMED         5
+
+/* Types */
+typedef struct
+{
+    uint8_t   port;
+    uint8_t   data[NS_MAX_FRAME];
+    uint8_t   len;
+    bool      confirmed;
+    uint32_t  queuedMs;
+} nsDownlink_t;
+
+typedef struct
+{
+    uint32_t  count;
+    uint32_t  minMs;
+    uint32_t  maxMs;
+    uint32_t  sumMs;
+} nsLatency_t;
+
+typedef struct
+{
+    /* Credentials, same byte order as _credentials.h */
+    uint8_t   appEui[8];
+    uint8_t   devEui[8];
+    uint8_t   appKey[16];
+
+    /* Session */
+    bool      joined;
+    uint32_t  devAddr;
+    uint8_t   nwkSKey[16];
+    uint8_t   appSKey[16];
+    uint32_t  fCntUp;
+    uint32_t  fCntDown;
+    uint16_t  lastDevNonce;
+    bool      devNonceSeen;
+    uint32_t  appNonce;
+    uint8_t   rxDelay;
+
+    /* Last received application uplink (decrypted) */
+    uint8_t   uplinkPort;
+    uint8_t   uplinkData[NS_MAX_FRAME];
+    uint8_t   uplinkLen;
+
+    /* Downlink queue (FIFO) */
+    nsDownlink_t queue[NS_DOWNLINK_QUEUE_SIZE];
+    uint8_t   queueHead;
+    uint8_t   queueCount;
+
+    /* Frame scheduled for the RX1/RX2 windows of the last uplink */
+    uint8_t   pending[NS_MAX_FRAME];
+    uint8_t   pendingLen;
+    uint32_t  pendingRx1Ms;
+    uint32_t  pendingRx2Ms;
+    uint32_t  pendingQueuedMs;
+    bool      pendingIsJoinAccept;
+
+    /* Metrics on the virtual clock */
+    uint32_t  firstJoinRequestMs;
+    bool      joinInProgress;
+    uint32_t  joinRequests;
+    uint32_t  micErrors;
+    uint32_t  missedWindows;
+    nsLatency_t joinLatency;
+    nsLatency_t downlinkRoundTrip;
+} networkServer_t;
+
+/* Variables */
+static networkServer_t networkServer;
+
+/* Functions */
+static void networkServerPut32(uint8_t *buf, uint32_t value)
+{
+    buf[0] = (uint8_t)(value);
+    buf[1] = (uint8_t)(value >> 8);
+    buf[2] = (uint8_t)(value >> 16);
+    buf[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t networkServerGet32(const uint8_t *buf)
+{
+    return (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+static void networkServerRecordLatency(nsLatency_t *latency, uint32_t elapsedMs)
+{
+    if (latency->count == 0 || elapsedMs < latency->minMs)
+    {
+        latency->minMs = elapsedMs;
+    }
+    if (elapsedMs > latency->maxMs)
+    {
+        latency->maxMs = elapsedMs;
+    }
+    latency->sumMs += elapsedMs;
+    latency->count++;
+}
+
+static uint32_t networkServerAverageMs(const nsLatency_t *latency)
+{
+    return latency->count ? (latency->sumMs / latency->count) : 0;
+}
+
+static void networkServerInit(const uint8_t *appEui, const uint8_t *devEui, const uint8_t *appKey, uint8_t rxDelay)
+{
+    memset(&networkServer, 0, sizeof(networkServer));
+    memcpy(networkServer.appEui, appEui, 8);
+    memcpy(networkServer.devEui, devEui, 8);
+    memcpy(networkServer.appKey, appKey, 16);
+    networkServer.rxDelay = rxDelay ? rxDelay : 1;
+}
+
+/* Activation by Personalization (ABP), same parameters as LMIC_setSession() */
+static void networkServerSetSession(uint32_t devAddr, const uint8_t *nwkSKey, const uint8_t *appSKey)
+{
+    networkServer.joined   = true;
+    networkServer.devAddr  = devAddr;
+    networkServer.fCntUp   = 0;
+    networkServer.fCntDown = 0;
+    memcpy(networkServer.nwkSKey, nwkSKey, 16);
+    memcpy(networkServer.appSKey, appSKey, 16);
+}
+
+static bool networkServerQueueDownlink(uint8_t port, const uint8_t *data, uint8_t len, bool confirmed, uint32_t nowMs)
+{
+    /* 13 bytes of MAC overhead: MHDR, FHDR (7), FPort, MIC (4) */
+    if (networkServer.queueCount >= NS_DOWNLINK_QUEUE_SIZE || len > NS_MAX_FRAME - 13 || port == 0)
+    {
+        return false;
+    }
+
+    uint8_t slot = (networkServer.queueHead + networkServer.queueCount) % NS_DOWNLINK_QUEUE_SIZE;
+    nsDownlink_t *downlink = &networkServer.queue[slot];
+
+    downlink->port      = port;
+    downlink->len       = len;
+    downlink->confirmed = confirmed;
+    downlink->queuedMs  = nowMs;
+    memcpy(downlink->data, data, len);
+    networkServer.queueCount++;
+    return true;
+}
+
+/* Join request (section 6.2.4) -> join accept (section 6.2.5) */
+static uint8_t networkServerJoinRequest(const uint8_t *frame, uint8_t len, uint32_t txEndMs)
+{
+    uint8_t mac[AES_BLOCK_SIZE];
+
+    if (len != 23)
+    {
+        return NS_UPLINK_MALFORMED;
+    }
+
+    /* MHDR | AppEUI | DevEUI | DevNonce | MIC */
+    if (memcmp(&frame[1], networkServer.appEui, 8) != 0 || memcmp(&frame[9], networkServer.devEui, 8) != 0)
+    {
+        return NS_UPLINK_UNKNOWN_DEVICE;
+    }
+
+    aesCmac(networkServer.appKey, frame, 19, mac);
+    if (memcmp(mac, &frame[19], 4) != 0)
+    {
+        networkServer.micErrors++;
+        return NS_UPLINK_MIC_ERROR;
+    }
+
+    uint16_t devNonce = (uint16_t)(frame[17] | (frame[18] << 8));
+    if (networkServer.devNonceSeen && devNonce == networkServer.lastDevNonce)
+    {
+        return NS_UPLINK_REPLAY;
+    }
+    networkServer.devNonceSeen = true;
+    networkServer.lastDevNonce = devNonce;
+
+    networkServer.joinRequests++;
+    if (!networkServer.joinInProgress)
+    {
+        networkServer.joinInProgress     = true;
+        networkServer.firstJoinRequestMs = txEndMs;
+    }
+
+    /* New session */
+    networkServer.appNonce = (networkServer.appNonce + 1) & 0xFFFFFF;
+    networkServer.devAddr  = NS_DEVADDR_BASE + networkServer.joinRequests;
+    networkServer.fCntUp   = 0;
+    networkServer.fCntDown = 0;
+
+    /* Session keys: aes128_encrypt(AppKey, 0x01|0x02 | AppNonce | NetID | DevNonce | pad16) */
+    uint8_t block[AES_BLOCK_SIZE] = {0};
+    block[1] = (uint8_t)(networkServer.appNonce);
+    block[2] = (uint8_t)(networkServer.appNonce >> 8);
+    block[3] = (uint8_t)(networkServer.appNonce >> 16);
+    block[4] = (uint8_t)(NS_NETID);
+    block[5] = (uint8_t)(NS_NETID >> 8);
+    block[6] = (uint8_t)(NS_NETID >> 16);
+    block[7] = frame[17];
+    block[8] = frame[18];
+
+    block[0] = 0x01;
+    aesEncryptBlock(networkServer.appKey, block, networkServer.nwkSKey);
+    block[0] = 0x02;
+    aesEncryptBlock(networkServer.appKey, block, networkServer.appSKey);
+
+    /* MHDR | AppNonce | NetID | DevAddr | DLSettings | RxDelay | MIC */
+    uint8_t *accept = networkServer.pending;
+    accept[0] = NS_MTYPE_JOIN_ACCEPT;
+    memcpy(&accept[1], &block[1], 6);
+    networkServerPut32(&accept[7], networkServer.devAddr);
+    accept[11] = NS_RX2_DATA_RATE & 0x0F;  /* RX1DRoffset = 0 */
+    accept[12] = networkServer.rxDelay;
+
+    aesCmac(networkServer.appKey, accept, 13, mac);
+    memcpy(&accept[13], mac, 4);
+
+    /* The network "decrypts" so that the node only needs the AES forward cipher */
+    aesDecryptBlock(networkServer.appKey, &accept[1], &accept[1]);
+
+    networkServer.pendingLen          = 17;
+    networkServer.pendingRx1Ms        = txEndMs + NS_JOIN_ACCEPT_DELAY1_MS;
+    networkServer.pendingRx2Ms        = txEndMs + NS_JOIN_ACCEPT_DELAY2_MS;
+    networkServer.pendingQueuedMs     = txEndMs;
+    networkServer.pendingIsJoinAccept = true;
+    networkServer.joined              = true;
+
+    return NS_UPLINK_JOINED;
+}
+
+/* Builds the answer to a data uplink: the head of the queue and/or an ACK */
+static void networkServerScheduleDownlink(bool ack, uint32_t txEndMs)
+{
+    nsDownlink_t *downlink = networkServer.queueCount ? &networkServer.queue[networkServer.queueHead] : NULL;
+
+    if (!ack && downlink == NULL)
+    {
+        return;
+    }
+
+    uint8_t *frame = networkServer.pending;
+    uint8_t  len   = 0;
+
+    frame[len++] = (downlink && downlink->confirmed) ? NS_MTYPE_CONFIRMED_DOWN : NS_MTYPE_UNCONFIRMED_DOWN;
+    networkServerPut32(&frame[len], networkServer.devAddr);
+    len += 4;
+    frame[len++] = ack ? NS_FCTRL_ACK : 0x00;
+    frame[len++] = (uint8_t)(networkServer.fCntDown);
+    frame[len++] = (uint8_t)(networkServer.fCntDown >> 8);
+
+    if (downlink)
+    {
+        frame[len++] = downlink->port;
+        memcpy(&frame[len], downlink->data, downlink->len);
+        aesLoRaWANPayload(networkServer.appSKey, networkServer.devAddr, networkServer.fCntDown, 1, &frame[len], downlink->len);
+        len += downlink->len;
+        networkServer.pendingQueuedMs = downlink->queuedMs;
+
+        networkServer.queueHead = (networkServer.queueHead + 1) % NS_DOWNLINK_QUEUE_SIZE;
+        networkServer.queueCount--;
+    }
+    else
+    {
+        networkServer.pendingQueuedMs = txEndMs;
+    }
+
+    uint32_t mic = aesLoRaWANMic(networkServer.nwkSKey, networkServer.devAddr, networkServer.fCntDown, 1, frame, len);
+    networkServerPut32(&frame[len], mic);
+    len += 4;
+
+    networkServer.fCntDown++;
+    networkServer.pendingLen          = len;
+    networkServer.pendingRx1Ms        = txEndMs + networkServer.rxDelay * 1000UL;
+    networkServer.pendingRx2Ms        = networkServer.pendingRx1Ms + 1000UL;
+    networkServer.pendingIsJoinAccept = false;
+}
+
+/* Data uplink (section 4) */
+static uint8_t networkServerDataUplink(const uint8_t *frame, uint8_t len, uint32_t txEndMs)
+{
+    /* MHDR | DevAddr | FCtrl | FCnt | FOpts | [FPort | FRMPayload] | MIC */
+    if (len < 12)
+    {
+        return NS_UPLINK_MALFORMED;
+    }
+
+    if (!networkServer.joined || networkServerGet32(&frame[1]) != networkServer.devAddr)
+    {
+        return NS_UPLINK_UNKNOWN_DEVICE;
+    }
+
+    uint8_t  fOptsLen = frame[5] & 0x0F;
+    uint16_t fCnt16   = (uint16_t)(frame[6] | (frame[7] << 8));
+
+    /* Rebuild the 32 bits frame counter from its 16 LSB */
+    uint32_t fCnt = (networkServer.fCntUp & 0xFFFF0000) | fCnt16;
+    if (fCnt < networkServer.fCntUp)
+    {
+        fCnt += 0x10000;
+    }
+
+    uint32_t mic = aesLoRaWANMic(networkServer.nwkSKey, networkServer.devAddr, fCnt, 0, frame, len - 4);
+    if (mic != networkServerGet32(&frame[len - 4]))
+    {
+        networkServer.micErrors++;
+        return NS_UPLINK_MIC_ERROR;
+    }
+    networkServer.fCntUp = fCnt + 1;
+
+    uint8_t payloadStart = 8 + fOptsLen;
+    if (payloadStart < len - 4)
+    {
+        networkServer.uplinkPort = frame[payloadStart];
+        networkServer.uplinkLen  = len - 4 - payloadStart - 1;
+        memcpy(networkServer.uplinkData, &frame[payloadStart + 1], networkServer.uplinkLen);
+
+        /* FPort 0 carries MAC commands only and is encrypted with the NwkSKey */
+        const uint8_t *key = networkServer.uplinkPort ? networkServer.appSKey : networkServer.nwkSKey;
+        aesLoRaWANPayload(key, networkServer.devAddr, fCnt, 0, networkServer.uplinkData, networkServer.uplinkLen);
+    }
+    else
+    {
+        networkServer.uplinkPort = 0;
+        networkServer.uplinkLen  = 0;
+    }
+
+    networkServerScheduleDownlink((frame[0] & 0xE0) == NS_MTYPE_CONFIRMED_UP, txEndMs);
+
+    return NS_UPLINK_OK;
+}
+
+/* Every frame transmitted by the node, txEndMs is the end of the transmission on the virtual clock */
+static uint8_t networkServerUplink(const uint8_t *frame, uint8_t len, uint32_t txEndMs)
+{
+    if (len == 0 || len > NS_MAX_FRAME)
+    {
+        return NS_UPLINK_MALFORMED;
+    }
+
+    /* A new uplink discards whatever was not picked up in the previous windows */
+    if (networkServer.pendingLen)
+    {
+        networkServer.missedWindows++;
+        networkServer.pendingLen = 0;
+    }
+
+    switch (frame[0] & 0xE0)
+    {
+    case NS_MTYPE_JOIN_REQUEST:
+        return networkServerJoinRequest(frame, len, txEndMs);
+    case NS_MTYPE_UNCONFIRMED_UP:
+    case NS_MTYPE_CONFIRMED_UP:
+        return networkServerDataUplink(frame, len, txEndMs);
+    default:
+        return NS_UPLINK_MALFORMED;
+    }
+}
+
+/*
+ *  Called when the node opens a receive window at openMs (virtual clock).
+ *  Returns the length of the frame copied to buffer, 0 if nothing is
+ *  transmitted in that window.
+ */
+static uint8_t networkServerRxWindow(uint32_t openMs, uint8_t *buffer)
+{
+    if (networkServer.pendingLen == 0)
+    {
+        return 0;
+    }
+
+    uint32_t rx1Error = (openMs > networkServer.pendingRx1Ms) ? openMs - networkServer.pendingRx1Ms : networkServer.pendingRx1Ms - openMs;
+    uint32_t rx2Error = (openMs > networkServer.pendingRx2Ms) ? openMs - networkServer.pendingRx2Ms : networkServer.pendingRx2Ms - openMs;
+
+    if (rx1Error > NS_RX_WINDOW_TOLERANCE_MS && rx2Error > NS_RX_WINDOW_TOLERANCE_MS)
+    {
+        /* Window opened at the wrong time, the gateway transmits into the void */
+        if (openMs > networkServer.pendingRx2Ms)
+        {
+            networkServer.missedWindows++;
+            networkServer.pendingLen = 0;
+        }
+        return 0;
+    }
+
+    uint8_t len = networkServer.pendingLen;
+    memcpy(buffer, networkServer.pending, len);
+    networkServer.pendingLen = 0;
+
+    if (networkServer.pendingIsJoinAccept)
+    {
+        networkServerRecordLatency(&networkServer.joinLatency, openMs - networkServer.firstJoinRequestMs);
+        networkServer.joinInProgress = false;
+    }
+    else
+    {
+        networkServerRecordLatency(&networkServer.downlinkRoundTrip, openMs - networkServer.pendingQueuedMs);
+    }
+
+    return len;
+}
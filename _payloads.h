@@ -0,0 +1,206 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+#pragma once
+
+/* Includes */
+#include <stdint.h>
+#include <string.h>
+
+/*
+ *  Uplink payload templates.
+ *  A message is declared once as a list of fields (payloadUnsigned,
+ *  payloadSigned, payloadText, payloadBytes), e.g.
+ *  
+ *      typedef payloadMessage<payloadUnsigned<1>, payloadUnsigned<2>, payloadText<4> > myMessage;
+ *  
+ *  and the compiler derives from it:
+ *      myMessage::size                     Maximum length, usable for static buffers;
+ *      myMessage::encode(buffer, a, b, c)  Node side, returns the encoded length;
+ *      myMessage::decode(buffer, &a, &b, c) Host side (tests, network server), returns the decoded length.
+ *  
+ *  Integers are big endian, the byte order used by the decoders on the
+ *  application server. A wrong number of values does not compile.
+ *  Like _crypto.h this file has no Arduino or LMiC dependencies.
+ */
+
+/* Unsigned integer of 1 to 4 bytes */
+template <uint8_t N>
+struct payloadUnsigned
+{
+    enum { size = N };
+    typedef uint32_t value_t;
+    typedef uint32_t *output_t;
+
+    static void encode(uint8_t *buffer, uint32_t value)
+    {
+        for (uint8_t i = 0; i < N; i++)
+        {
+            buffer[i] = (uint8_t)(value >> (8 * (N - 1 - i)));
+        }
+    }
+
+    static void decode(const uint8_t *buffer, uint32_t *value)
+    {
+        *value = 0;
+        for (uint8_t i = 0; i < N; i++)
+        {
+            *value = (*value << 8) | buffer[i];
+        }
+    }
+};
+
+/* Signed integer of 1 to 4 bytes, two's complement */
+template <uint8_t N>
+struct payloadSigned
+{
+    enum { size = N };
+    typedef int32_t value_t;
+    typedef int32_t *output_t;
+
+    static void encode(uint8_t *buffer, int32_t value)
+    {
+        payloadUnsigned<N>::encode(buffer, (uint32_t)value);
+    }
+
+    static void decode(const uint8_t *buffer, int32_t *value)
+    {
+        uint32_t raw;
+        payloadUnsigned<N>::decode(buffer, &raw);
+        if (N < 4 && (raw & (1UL << (8 * N - 1))))
+        {
+            raw |= ~0UL << (8 * N);     /* Sign extension */
+        }
+        *value = (int32_t)raw;
+    }
+};
+
+/* Fixed length ASCII text, padded with zeros, no terminator on air */
+template <uint8_t N>
+struct payloadText
+{
+    enum { size = N };
+    typedef const char *value_t;
+    typedef char *output_t;             /* N + 1 bytes, zero terminated */
+
+    static void encode(uint8_t *buffer, const char *value)
+    {
+        uint8_t i = 0;
+        for (; i < N && value[i] != '\0'; i++)
+        {
+            buffer[i] = (uint8_t)value[i];
+        }
+        for (; i < N; i++)
+        {
+            buffer[i] = 0;
+        }
+    }
+
+    static void decode(const uint8_t *buffer, char *value)
+    {
+        memcpy(value, buffer, N);
+        value[N] = '\0';
+    }
+};
+
+/* Fixed length raw bytes */
+template <uint8_t N>
+struct payloadBytes
+{
+    enum { size = N };
+    typedef const uint8_t *value_t;
+    typedef uint8_t *output_t;
+
+    static void encode(uint8_t *buffer, const uint8_t *value)
+    {
+        memcpy(buffer, value, N);
+    }
+
+    static void decode(const uint8_t *buffer, uint8_t *value)
+    {
+        memcpy(value, buffer, N);
+    }
+};
+
+/* Field list */
+template <typename... Fields>
+struct payloadMessage;
+
+template <>
+struct payloadMessage<>
+{
+    enum { size = 0 };
+
+    static uint8_t encode(uint8_t *)
+    {
+        return 0;
+    }
+
+    static uint8_t decode(const uint8_t *)
+    {
+        return 0;
+    }
+};
+
+template <typename Field, typename... Rest>
+struct payloadMessage<Field, Rest...>
+{
+    enum { size = Field::size + payloadMessage<Rest...>::size };
+
+    template <typename... Values>
+    static uint8_t encode(uint8_t *buffer, typename Field::value_t value, Values... values)
+    {
+        Field::encode(buffer, value);
+        return Field::size + payloadMessage<Rest...>::encode(buffer + Field::size, values...);
+    }
+
+    template <typename... Outputs>
+    static uint8_t decode(const uint8_t *buffer, typename Field::output_t value, Outputs... values)
+    {
+        Field::decode(buffer, value);
+        return Field::size + payloadMessage<Rest...>::decode(buffer + Field::size, values...);
+    }
+};
@@ -0,0 +1,217 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+#pragma once
+
+/*
+ *  Profiler
+ *  
+ *  Flat profile of where loop() spends its time. PROFILE_SCOPE(id) at the top
+ *  of a block times it until the block ends; per scope the profile keeps the
+ *  number of calls, the total and the longest call, in static memory.
+ *  
+ *  Clocks: CPU cycle counter on ESP32, micros() on other boards and 64-bit
+ *  nanoseconds of clock_gettime() on a host build (PROFILER_CLOCK_CUSTOM: the
+ *  build provides profilerHostNs(), see tests/test_profiler.cpp). A 32-bit
+ *  tick counter is fine as long as one call lasts less than a wrap: 2^32
+ *  cycles, 17.9 s at the default 240 MHz (26.8 s at 160 MHz), or 71 min with
+ *  micros(). Times are inclusive: onEvent runs inside
+ *  os_runloop_once, which also covers the radio IRQ handling and its SPI
+ *  traffic, so idle = window - os_runloop_once - the scopes outside of it.
+ *  
+ *  profilerDump() prints the profile of the current window on DEBUG_PORT and
+ *  starts a new one; in the sketch it runs when PROFILER_DUMP_KEY arrives on
+ *  the serial port. Without USE_PROFILER every PROFILE_SCOPE() is empty and
+ *  nothing of this file is compiled.
+ */
+
+/* Scopes */
+#define PROFILER_RUNLOOP            0       /* os_runloop_once() */
+#define PROFILER_DO_SEND            1
+#define PROFILER_LOGS               2       /* _logs.h functions */
+#define PROFILER_DOWNLINKS_RULE     3
+#define PROFILER_EVENT_FIRST        4       /* onEvent(), one scope per ev_t */
+#define PROFILER_EVENTS             24
+#define PROFILER_SCOPES             (PROFILER_EVENT_FIRST + PROFILER_EVENTS)
+
+#define PROFILER_EVENT(ev)          (PROFILER_EVENT_FIRST + ((ev) < PROFILER_EVENTS ? (ev) : 0))
+
+#ifdef USE_PROFILER
+
+/* Includes */
+#include <stdint.h>
+#include <string.h>
+#if !defined(ARDUINO)
+#include <stdio.h>
+#include <time.h>
+#endif
+
+/* Clock */
+#if defined(ARDUINO_ARCH_ESP32)
+typedef uint32_t profilerTicks_t;
+#define PROFILER_NOW()              ESP.getCycleCount()
+#define PROFILER_TICKS_PER_US       getCpuFrequencyMhz()
+#define PROFILER_MS()               millis()
+#elif defined(ARDUINO)
+typedef uint32_t profilerTicks_t;
+#define PROFILER_NOW()              micros()
+#define PROFILER_TICKS_PER_US       1
+#define PROFILER_MS()               millis()
+#else
+typedef uint64_t profilerTicks_t;
+#ifdef PROFILER_CLOCK_CUSTOM
+uint64_t profilerHostNs();
+#else
+uint64_t profilerHostNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+#endif
+#define PROFILER_NOW()              profilerHostNs()
+#define PROFILER_TICKS_PER_US       1000
+#define PROFILER_MS()               ((uint32_t)(profilerHostNs() / 1000000))    /* Wraps like millis() */
+#endif
+
+/* Types */
+typedef struct
+{
+    uint32_t        calls;
+    uint64_t        ticks;
+    profilerTicks_t maxTicks;
+} profilerScope_t;
+
+/* Variables */
+profilerScope_t profilerScopes[PROFILER_SCOPES];
+uint32_t        profilerWindowMs = 0;
+
+const char *profilerNames[PROFILER_EVENT_FIRST] = { "os_runloop_once", "do_send", "_logs.h", "downlinksRule" };
+
+/* Functions */
+void profilerRecord(uint8_t id, profilerTicks_t ticks)
+{
+    profilerScope_t *scope = &profilerScopes[id];
+    scope->calls++;
+    scope->ticks += ticks;
+    if (ticks > scope->maxTicks)
+    {
+        scope->maxTicks = ticks;
+    }
+}
+
+/* Times the enclosing block */
+struct profilerGuard
+{
+    uint8_t         id;
+    profilerTicks_t start;
+
+    profilerGuard(uint8_t scope) : id(scope), start(PROFILER_NOW()) {}
+    ~profilerGuard() { profilerRecord(id, PROFILER_NOW() - start); }
+};
+
+#define PROFILER_CONCAT(a, b)       a##b
+#define PROFILER_GUARD(id, line)    profilerGuard PROFILER_CONCAT(profilerGuard, line)(id)
+#define PROFILE_SCOPE(id)           PROFILER_GUARD(id, __LINE__)
+
+void profilerReset()
+{
+    memset(profilerScopes, 0, sizeof(profilerScopes));
+    profilerWindowMs = PROFILER_MS();
+}
+
+/* Flat profile of the window: scope, calls, total us, share of the window, longest call us */
+void profilerDump()
+{
+    uint64_t windowUs = (uint64_t)(PROFILER_MS() - profilerWindowMs) * 1000;
+
+    for (uint8_t id = 0; id < PROFILER_SCOPES; id++)
+    {
+        const profilerScope_t *scope = &profilerScopes[id];
+        if (scope->calls == 0)
+        {
+            continue;
+        }
+        uint32_t totalUs = (uint32_t)(scope->ticks / PROFILER_TICKS_PER_US);
+        uint32_t share   = windowUs ? (uint32_t)((uint64_t)totalUs * 1000 / windowUs) : 0;   /* Per mille */
+        uint32_t maxUs   = (uint32_t)(scope->maxTicks / PROFILER_TICKS_PER_US);
+
+#if defined(ARDUINO)
+        #ifdef DEBUG
+        String name = (id < PROFILER_EVENT_FIRST) ? String(profilerNames[id]) : "onEvent " + String(id - PROFILER_EVENT_FIRST);
+        DEBUG_PORT.println(" [PROF] " + name + " : " + String(scope->calls) + " calls, " + String(totalUs) + " us, "
+                           + String(share / 10) + "." + String(share % 10) + " %, max " + String(maxUs) + " us");
+        #endif
+#else
+        if (id < PROFILER_EVENT_FIRST)
+        {
+            printf(" [PROF] %s : ", profilerNames[id]);
+        }
+        else
+        {
+            printf(" [PROF] onEvent %u : ", (unsigned)(id - PROFILER_EVENT_FIRST));
+        }
+        printf("%lu calls, %lu us, %lu.%lu %%, max %lu us\n", (unsigned long)scope->calls, (unsigned long)totalUs,
+               (unsigned long)(share / 10), (unsigned long)(share % 10), (unsigned long)maxUs);
+#endif
+    }
+
+#if defined(ARDUINO)
+    #ifdef DEBUG
+    DEBUG_PORT.println(" [PROF] Window : " + String((uint32_t)(windowUs / 1000)) + " ms");
+    #endif
+#else
+    printf(" [PROF] Window : %lu ms\n", (unsigned long)(windowUs / 1000));
+#endif
+
+    profilerReset();
+}
+
+#else
+
+#define PROFILE_SCOPE(id)
+
+#endif
@@ -0,0 +1,273 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+#pragma once
+
+/* Includes */
+#include <lmic.h>
+#if defined(ARDUINO_ARCH_ESP32)
+#include <esp_system.h>     /* esp_reset_reason() */
+#include <esp_task_wdt.h>
+#if __has_include(<esp_idf_version.h>)
+#include <esp_idf_version.h>    /* ESP-IDF 4 and later */
+#endif
+#endif
+
+/*
+ *  Supervisor
+ *  
+ *  Watches the node from loop() and escalates when it stops making progress:
+ *  
+ *  Radio deadline    : OP_TXRXPEND set for longer than SUPERVISOR_TXRX_DEADLINE_MS
+ *  Uplink deadline   : joined, and no EV_TXCOMPLETE for SUPERVISOR_MISSED_INTERVALS x TX_INTERVAL
+ *  Loop watchdog     : ESP32 task watchdog on loop(), SUPERVISOR_LOOP_TIMEOUT_S, panics and restarts
+ *  
+ *  Each deadline missed in a row raises the level, EV_TXCOMPLETE clears it:
+ *  1 - LMIC_clrTxData() and a new uplink
+ *  2 - LMIC_reset() and rejoin (session restored under ABP)
+ *  3 - hardware restart
+ *  
+ *  The reason, the level and the last LMiC events are kept in RTC memory, which
+ *  survives the restart, and go out on SUPERVISOR_PORT in the first uplink after
+ *  a recovery or after a watchdog, panic or brownout reset:
+ *  | reason (1) | level (1) | reset reason (1) | restarts (2) | last events, oldest first (8) |
+ */
+
+/* Definitions */
+#define SUPERVISOR_MAGIC            0x53555056UL    /* "SUPV" */
+#define SUPERVISOR_EVENTS           8
+
+/* Reasons */
+#define SUPERVISOR_NONE             0
+#define SUPERVISOR_TXRX_DEADLINE    1
+#define SUPERVISOR_UPLINK_DEADLINE  2
+#define SUPERVISOR_RESET            3       /* Abnormal reset seen at boot (esp_reset_reason) */
+
+/* Levels */
+#define SUPERVISOR_LEVEL_CLEAR      1
+#define SUPERVISOR_LEVEL_REJOIN     2
+#define SUPERVISOR_LEVEL_RESTART    3
+
+/* Types */
+typedef struct
+{
+    u4_t magic;
+    u1_t reason;
+    u1_t level;
+    u1_t resetReason;
+    u2_t restarts;
+    u1_t events[SUPERVISOR_EVENTS];     /* Ring of ev_t */
+    u1_t eventIndex;
+} supervisorContext_t;
+
+/* Variables */
+#if defined(ARDUINO_ARCH_ESP32)
+RTC_NOINIT_ATTR supervisorContext_t supervisorContext;  /* Not cleared by esp_restart() or the watchdog */
+#else
+supervisorContext_t supervisorContext __attribute__((section(".noinit")));
+#endif
+bool  supervisorReportPending = false;
+u1_t  supervisorLevel         = 0;
+u4_t  supervisorTxRxSince     = 0;      /* millis() when OP_TXRXPEND was first seen, 0 if clear */
+u4_t  supervisorLastProgress  = 0;      /* millis() of the last EV_TXCOMPLETE */
+
+/* Functions */
+/* Resets that deserve a report */
+bool supervisorAbnormalReset(u1_t resetReason)
+{
+#if defined(ARDUINO_ARCH_ESP32)
+    return resetReason == ESP_RST_PANIC || resetReason == ESP_RST_INT_WDT || resetReason == ESP_RST_TASK_WDT
+        || resetReason == ESP_RST_WDT || resetReason == ESP_RST_BROWNOUT;
+#else
+    return false;
+#endif
+}
+
+/* Watchdog on the calling task, the one running os_runloop_once() */
+void supervisorWatchTask()
+{
+#if defined(ARDUINO_ARCH_ESP32)
+    esp_task_wdt_add(NULL);
+#endif
+}
+
+/* Call once in setup(), before any LMiC event */
+void supervisorBegin()
+{
+    u1_t resetReason = 0;
+    bool powerOn = false;           /* RTC memory holds garbage */
+#if defined(ARDUINO_ARCH_ESP32)
+    resetReason = (u1_t)esp_reset_reason();
+    powerOn = (resetReason == ESP_RST_POWERON);
+#endif
+
+    if (supervisorContext.magic != SUPERVISOR_MAGIC || powerOn)
+    {
+        memset(&supervisorContext, 0, sizeof(supervisorContext));
+        supervisorContext.magic = SUPERVISOR_MAGIC;
+    }
+
+    supervisorContext.resetReason = resetReason;
+    if (supervisorContext.reason == SUPERVISOR_NONE && supervisorAbnormalReset(resetReason))
+    {
+        supervisorContext.reason = SUPERVISOR_RESET;
+    }
+    supervisorReportPending = (supervisorContext.reason != SUPERVISOR_NONE);
+
+#if defined(ARDUINO_ARCH_ESP32)
+    /* Panics on timeout, the reset reason tells the next boot about it */
+#if defined(ESP_IDF_VERSION_MAJOR) && ESP_IDF_VERSION_MAJOR >= 5
+    esp_task_wdt_config_t watchdogConfig = {
+        .timeout_ms     = SUPERVISOR_LOOP_TIMEOUT_S * 1000,
+        .idle_core_mask = 0,
+        .trigger_panic  = true
+    };
+    /* Arduino core 3 already started it at boot */
+    if (esp_task_wdt_reconfigure(&watchdogConfig) != ESP_OK)
+    {
+        esp_task_wdt_init(&watchdogConfig);
+    }
+#else
+    esp_task_wdt_init(SUPERVISOR_LOOP_TIMEOUT_S, true);
+#endif
+#ifndef USE_DUAL_CORE
+    supervisorWatchTask();
+#endif
+#endif
+
+    supervisorLastProgress = millis();
+}
+
+/* Call first thing in onEvent() */
+void supervisorEvent(ev_t ev)
+{
+    supervisorContext.events[supervisorContext.eventIndex] = (u1_t)ev;
+    supervisorContext.eventIndex = (supervisorContext.eventIndex + 1) % SUPERVISOR_EVENTS;
+
+    if (ev == EV_TXCOMPLETE || ev == EV_JOINED)
+    {
+        supervisorLevel = 0;
+        supervisorLastProgress = millis();
+    }
+}
+
+/*
+ *  Call from loop(), feeds the watchdog. Returns the recovery level to apply
+ *  now, 0 while everything is fine. Deadlines restart after each escalation.
+ */
+u1_t supervisorCheck(u4_t nowMs)
+{
+#if defined(ARDUINO_ARCH_ESP32)
+    esp_task_wdt_reset();
+#endif
+
+    u1_t reason = SUPERVISOR_NONE;
+
+    if (LMIC.opmode & OP_TXRXPEND)
+    {
+        if (supervisorTxRxSince == 0)
+        {
+            supervisorTxRxSince = nowMs | 1;
+        }
+        else if (nowMs - supervisorTxRxSince > SUPERVISOR_TXRX_DEADLINE_MS)
+        {
+            reason = SUPERVISOR_TXRX_DEADLINE;
+        }
+    }
+    else
+    {
+        supervisorTxRxSince = 0;
+    }
+
+    /* Not joined yet: the join scheduler may be backing off on purpose */
+    if (reason == SUPERVISOR_NONE && LMIC.devaddr != 0 && !(LMIC.opmode & OP_JOINING)
+        && nowMs - supervisorLastProgress > (u4_t)SUPERVISOR_MISSED_INTERVALS * TX_INTERVAL * 1000)
+    {
+        reason = SUPERVISOR_UPLINK_DEADLINE;
+    }
+
+    if (reason == SUPERVISOR_NONE)
+    {
+        return 0;
+    }
+
+    if (supervisorLevel < SUPERVISOR_LEVEL_RESTART)
+    {
+        supervisorLevel++;
+    }
+    supervisorContext.reason = reason;
+    supervisorContext.level  = supervisorLevel;
+    supervisorReportPending  = true;
+    supervisorTxRxSince      = 0;
+    supervisorLastProgress   = nowMs;
+    return supervisorLevel;
+}
+
+/* Last level, the context stays in RTC memory */
+void supervisorRestart()
+{
+    supervisorContext.restarts++;
+#if defined(ARDUINO_ARCH_ESP32)
+    esp_restart();
+#endif
+}
+
+/* Last events, oldest first */
+void supervisorEvents(u1_t *events)
+{
+    for (u1_t i = 0; i < SUPERVISOR_EVENTS; i++)
+    {
+        events[i] = supervisorContext.events[(supervisorContext.eventIndex + i) % SUPERVISOR_EVENTS];
+    }
+}
+
+/* After the report went out */
+void supervisorReported()
+{
+    supervisorReportPending  = false;
+    supervisorContext.reason = SUPERVISOR_NONE;
+    supervisorContext.level  = 0;
+}
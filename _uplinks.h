@@ -46,17 +46,36 @@
 
 #pragma once
 
-/* Payloads */
-//uint8_t payload_HexadecimalValue_101[1] = { 0x65 }; /* Test - Send Decimal: 101 - ASCII: "e" */
+/* Includes */
+#include <lmic.h>
+#include "_payloads.h"
 
-/* Only accepts decimal values */
-//byte payloadMyNameHorizontalBytes[10] = { 65, 100, 97, 105, 108, 83, 105, 108, 118, 97 };
+/* Messages (see _payloads.h) */
+/* Payload My Name, ASCII text: AdailSilva */
+typedef payloadMessage<payloadText<10> > payloadMyName_t;
 
-/* Relay uplink - Ok */
-byte payloadRelayUplink[17] = { 82, 101, 108, 97, 121, 32, 117, 112, 108, 105, 110, 107, 32, 45, 32, 79, 107 };
+/* Relay uplink, ASCII text: Relay uplink - Ok */
+typedef payloadMessage<payloadText<17> > payloadRelayUplink_t;
 
 /* Send Functions */
 
+/* Shipments - Byte uploads */
+/*
+ *  Encodes the message straight into the LMiC pending TX buffer and
+ *  queues it, avoiding a copy through a local array. Only call while
+ *  no TX is pending (OP_TXRXPEND clear), as do_send() already checks.
+ */
+template <typename Message, typename... Values>
+void payloadTransmit(u1_t port, bool confirmed, Values... values)
+{
+    static_assert(Message::size <= sizeof(LMIC.pendTxData), "Payload larger than the LMiC TX buffer");
+
+    u1_t length = Message::encode(LMIC.pendTxData, values...);
+
+    /* A NULL data pointer tells LMiC the payload is already in pendTxData */
+    LMIC_setTxData2(port, NULL, length, confirmed ? 1 : 0);
+}
+
 /* Shipments - Byte uploads */
 /* Calls uplink sending function */
 void payloadSend(uint8_t port, uint8_t * data, uint8_t data_size, bool confirmed)
@@ -80,23 +99,63 @@ void payloadMyNameVerticalBytes()
      *  Decimal:     65 100 97 105 108 83 105 108 118 97
      *  Binary:      01000001 01100100 01100001 01101001 01101100 01010011 01101001 01101100 01110110 01100001
      */
-    byte payload[10];
-
-    payload[0] = 65;
-    payload[1] = 100;
-    payload[2] = 97;
-    payload[3] = 105;
-    payload[4] = 108;
-    payload[5] = 83;
-    payload[6] = 105;
-    payload[7] = 108;
-    payload[8] = 118;
-    payload[9] = 97;
-
-    /* Direct Transmission LMiC */
+    payloadTransmit<payloadMyName_t>(UPLINK_PORT, UPLINK_CONFIRMED, "AdailSilva");
+}
+
+/* Shipments - Byte uploads */
+/* Calls uplink sending function */
+void payloadRelayUplink()
+{
     /*
-     *  Prepare upstream data transmission at the next possible time.
-     *  Parameters are port, data, length, confirmed.
+     *  Relay uplink
+     *  ASCII text:  Relay uplink - Ok
+     *  Hexadecimal: 52 65 6C 61 79 20 75 70 6C 69 6E 6B 20 2D 20 4F 6B
+     */
+    payloadTransmit<payloadRelayUplink_t>(UPLINK_PORT, UPLINK_CONFIRMED, "Relay uplink - Ok");
+}
+
+#ifdef USE_ENERGY_ACCUMULATOR
+/* Shipments - Byte uploads */
+/* Calls uplink sending function */
+void payloadEnergy()
+{
+    /*
+     *  Energy total, anchor or delta (see _energy.h)
+     *  Anchor:  80+i TT TT TT TT   --> total = TTTTTTTT Wh, i = anchor id (0 to 7)
+     *  Delta:   iD DD              --> total = total of anchor i + DDD Wh
+     *  Delta:   iD DD DD           --> total = total of anchor i + DDDDD Wh
      */
-     LMIC_setTxData2(UPLINK_PORT, payload, sizeof(payload), UPLINK_CONFIRMED);
+    u1_t size = energyPayload(LMIC.pendTxData);
+
+    /* Direct Transmission LMiC, already in pendTxData (see payloadTransmit) */
+    LMIC_setTxData2(ENERGY_UPLINK_PORT, NULL, size, UPLINK_CONFIRMED);
+}
+#endif
+
+#ifdef USE_FUOTA
+/* Firmware update status: | state (1) | received (2) | missing (2) | */
+typedef payloadMessage<payloadUnsigned<1>, payloadUnsigned<2>, payloadUnsigned<2> > payloadFuotaStatus_t;
+
+/* Shipments - Byte uploads */
+/* Calls uplink sending function */
+void payloadFuotaStatus()
+{
+    payloadTransmit<payloadFuotaStatus_t>(FUOTA_PORT, false, fuota.state, fuota.received, fuotaMissing());
+}
+#endif
+
+#ifdef USE_SUPERVISOR
+/* Recovery report: | reason (1) | level (1) | reset reason (1) | restarts (2) | last events (8) | */
+typedef payloadMessage<payloadUnsigned<1>, payloadUnsigned<1>, payloadUnsigned<1>, payloadUnsigned<2>, payloadBytes<SUPERVISOR_EVENTS> > payloadSupervisorReport_t;
+
+/* Shipments - Byte uploads */
+/* Calls uplink sending function */
+void payloadSupervisorReport()
+{
+    u1_t events[SUPERVISOR_EVENTS];
+    supervisorEvents(events);
+    
+    payloadTransmit<payloadSupervisorReport_t>(SUPERVISOR_PORT, false, supervisorContext.reason, supervisorContext.level,
+                                               supervisorContext.resetReason, supervisorContext.restarts, events);
 }
+#endif
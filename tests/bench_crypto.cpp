@@ -0,0 +1,103 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+
+/*
+ *  Host microbenchmark of the AES backends (make -C tests bench). Host
+ *  numbers only rank the software backends, the hardware backend is
+ *  timed on the board with AES_SELF_TEST.
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <chrono>
+#include "_crypto.h"
+
+/* Definitions */
+#define BENCH_BLOCKS                200000
+
+/* Variables */
+volatile uint8_t benchSink;
+
+static double benchNs(aesEncryptFunction_t encrypt, const uint8_t *key)
+{
+    uint8_t block[AES_BLOCK_SIZE] = {0};
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < BENCH_BLOCKS; n++)
+    {
+        encrypt(key, block, block);
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    /* Keeps the loop from being optimized out */
+    benchSink = block[0];
+    return std::chrono::duration<double, std::nano>(end - start).count() / BENCH_BLOCKS;
+}
+
+int main()
+{
+    static const uint8_t key[AES_BLOCK_SIZE] = {0x70, 0xDC, 0xA9, 0x80, 0x78, 0x37, 0x4C, 0x51, 0x63, 0x3E, 0x4D, 0x73, 0x16, 0xA6, 0xB3, 0xB1};
+    uint8_t frame[23] = {0x40};
+    uint8_t mac[AES_BLOCK_SIZE];
+
+    for (uint8_t i = 0; i < AES_BACKENDS_COUNT; i++)
+    {
+        printf(" [INFO] %-20s: %8.1f ns/block\n", aesBackends[i].name, benchNs(aesBackends[i].encrypt, key));
+    }
+
+    /* MIC of a 23 bytes uplink: B0 block + 2 blocks of CMAC with the selected backend */
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < BENCH_BLOCKS / 4; n++)
+    {
+        frame[6] = (uint8_t)n;
+        aesCmac(key, frame, sizeof(frame), mac);
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    printf(" [INFO] %-20s: %8.1f ns/frame\n", "CMAC 23 bytes", std::chrono::duration<double, std::nano>(end - start).count() / (BENCH_BLOCKS / 4));
+
+    return 0;
+}
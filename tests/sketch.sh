@@ -0,0 +1,27 @@
+#!/bin/sh
+#
+#  Writes the sketch as a single C++ translation unit, the way the Arduino
+#  builder assembles it: main .ino first, then the other tabs in alphabetical
+#  order, with prototypes of the top-level .ino functions in front.
+#
+#  Usage: tests/sketch.sh > build/sketch.cpp
+#
+
+cd "$(dirname "$0")/.." || exit 1
+
+MAIN=LoRaWAN_Node_Skeleton.ino
+TABS=$(ls *.ino | grep -v "^$MAIN\$")
+
+echo "#include <Arduino.h>"
+echo "#include <lmic.h>"
+
+# Function definitions start at column 0 and end the line with ')'
+cat $MAIN $TABS \
+    | grep -E '^[A-Za-z_][A-Za-z0-9_ *]* \**[A-Za-z_][A-Za-z0-9_]*\([^;]*\)\s*$' \
+    | grep -vE '^(if|for|while|switch|else|return) ' \
+    | sed 's/$/;/'
+
+for file in $MAIN $TABS; do
+    echo "#line 1 \"$PWD/$file\""
+    cat "$file"
+done
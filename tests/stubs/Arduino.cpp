@@ -0,0 +1,70 @@
+/*
+ *  Host implementation of stubs/Arduino.h on a virtual clock.
+ */
+
+/* Includes */
+#include "Arduino.h"
+#include "EEPROM.h"
+
+/* Variables */
+HardwareSerial Serial;
+HardwareSerial Serial2;
+EEPROMClass    EEPROM;
+
+uint32_t arduinoRestarts = 0;
+
+static uint64_t arduinoNowUs = 0;
+
+/* Functions */
+unsigned long millis()
+{
+    return (unsigned long)(arduinoNowUs / 1000);
+}
+
+unsigned long micros()
+{
+    return (unsigned long)arduinoNowUs;
+}
+
+void delay(unsigned long ms)
+{
+    arduinoNowUs += (uint64_t)ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    arduinoNowUs += us;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+void digitalWrite(uint8_t pin, uint8_t value) {}
+
+long random(long max)
+{
+    return max > 0 ? rand() % max : 0;
+}
+
+long random(long min, long max)
+{
+    return max > min ? min + rand() % (max - min) : min;
+}
+
+void randomSeed(unsigned long seed)
+{
+    srand((unsigned int)seed);
+}
+
+void esp_restart()
+{
+    arduinoRestarts++;
+}
+
+void arduinoAdvanceUs(uint64_t us)
+{
+    arduinoNowUs += us;
+}
+
+void arduinoResetClock()
+{
+    arduinoNowUs = 0;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+/*
+ *  Host stand-in for the Arduino core, only what the sketch uses.
+ *  Time is virtual (see Arduino.cpp): it only moves with delay() and the
+ *  test helpers of lmic.h, so a test runs the same way on every machine.
+ *  FreeRTOS tasks are std::threads on the real clock (see freertos.cpp),
+ *  only for the tests that link it.
+ */
+
+/* Includes */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#ifndef ARDUINO
+#define ARDUINO                     10819
+#endif
+
+/* Definitions */
+#define PROGMEM
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+#define F(x)                        (x)
+#define memcpy_P                    memcpy
+#define pgm_read_byte(p)            (*(const uint8_t *)(p))
+
+#define HIGH                        1
+#define LOW                         0
+#define OUTPUT                      1
+#define DEC                         10
+#define HEX                         16
+
+/* FreeRTOS, as the ESP32 core includes it, 1 ms ticks */
+#define configMAX_PRIORITIES        25
+#define portTICK_PERIOD_MS          1
+#define pdMS_TO_TICKS(ms)           ((TickType_t)(ms))
+
+/* Types */
+typedef uint8_t byte;
+
+typedef uint32_t TickType_t;
+typedef int      BaseType_t;
+typedef void    *TaskHandle_t;
+typedef void   (*TaskFunction_t)(void *);
+
+class String
+{
+public:
+    String() {}
+    String(const char *text) : text(text) {}
+    String(char c) : text(1, c) {}
+    template <typename T> String(T value, int base = 10)
+    {
+        char buffer[32];
+        if (base == HEX)
+        {
+            snprintf(buffer, sizeof(buffer), "%llX", (unsigned long long)value);
+            text = buffer;
+        }
+        else
+        {
+            text = std::to_string(value);
+        }
+    }
+
+    String operator+(const String &other) const { return String((text + other.text).c_str()); }
+    friend String operator+(const char *left, const String &right) { return String(left) + right; }
+    String &operator+=(const String &other) { text += other.text; return *this; }
+    bool operator==(const char *other) const { return text == other; }
+
+    size_t length() const { return text.size(); }
+    const char *c_str() const { return text.c_str(); }
+
+private:
+    std::string text;
+};
+
+class HardwareSerial
+{
+public:
+    void begin(unsigned long) {}
+    void setTimeout(unsigned long) {}
+    operator bool() const { return true; }
+
+    template <typename T> void print(T) {}
+    template <typename T> void print(T, int) {}
+    template <typename T> void println(T) {}
+    template <typename T> void println(T, int) {}
+    void println() {}
+    template <typename... A> void printf(const char *, A...) {}
+
+    int available() { return 0; }
+    int read() { return -1; }
+    size_t readBytes(uint8_t *, size_t) { return 0; }
+    size_t write(uint8_t) { return 1; }
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial2;
+
+/* Functions */
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+/* ESP32 core: counted, see arduinoRestarts */
+void esp_restart();
+
+/* FreeRTOS: the task runs on a detached thread, xPortGetCoreID() returns its core */
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stack, void *parameter,
+                                   unsigned priority, TaskHandle_t *handle, BaseType_t core);
+BaseType_t xPortGetCoreID();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+TickType_t xTaskGetTickCount();
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *wake, TickType_t ticks);
+
+/* Test control */
+extern uint32_t arduinoRestarts;
+void arduinoAdvanceUs(uint64_t us);
+void arduinoResetClock();
@@ -0,0 +1,13 @@
+#pragma once
+
+/* Host stand-in: reads leave the value untouched, writes are dropped */
+class EEPROMClass
+{
+public:
+    void begin(size_t) {}
+    void commit() {}
+    template <typename T> T &get(int, T &value) { return value; }
+    template <typename T> const T &put(int, const T &value) { return value; }
+};
+
+extern EEPROMClass EEPROM;
@@ -0,0 +1,19 @@
+#pragma once
+
+/* Includes */
+#include <math.h>
+#include "Arduino.h"
+
+/* Host stand-in: no meter on the bus, every read fails like a disconnected PZEM */
+class PZEM004Tv30
+{
+public:
+    PZEM004Tv30(HardwareSerial &, uint8_t = 0, uint8_t = 0) {}
+    float voltage() { return NAN; }
+    float current() { return NAN; }
+    float power() { return NAN; }
+    float energy() { return NAN; }
+    float frequency() { return NAN; }
+    float pf() { return NAN; }
+    bool resetEnergy() { return true; }
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+/* Includes */
+#include "Arduino.h"
+
+/* Host stand-in: an empty NVS namespace, writes are accepted and dropped */
+class Preferences
+{
+public:
+    bool begin(const char *, bool) { return true; }
+    void end() {}
+    size_t getBytes(const char *, void *, size_t) { return 0; }
+    size_t putBytes(const char *, const void *, size_t len) { return len; }
+};
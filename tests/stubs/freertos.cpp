@@ -0,0 +1,68 @@
+/*
+ *  Host implementation of the FreeRTOS part of stubs/Arduino.h: one
+ *  std::thread per task, the core it is pinned to in a thread_local. The
+ *  main thread stands for the Arduino loop() task, on core 1. A task handle
+ *  is the address of a thread_local, distinct for every live thread.
+ */
+
+/* Includes */
+#include <chrono>
+#include <thread>
+#include "Arduino.h"
+
+/* Variables */
+static thread_local BaseType_t freertosCore = 1;
+static thread_local char       freertosTask;
+
+/* Functions */
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stack, void *parameter,
+                                   unsigned priority, TaskHandle_t *handle, BaseType_t core)
+{
+    std::thread([=]()
+    {
+        freertosCore = core;
+        task(parameter);
+    }).detach();
+
+    if (handle != NULL)
+    {
+        *handle = NULL;
+    }
+    return 1;   /* pdPASS */
+}
+
+BaseType_t xPortGetCoreID()
+{
+    return freertosCore;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    return &freertosTask;
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return (TickType_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    if (ticks == 0)
+    {
+        std::this_thread::yield();
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+void vTaskDelayUntil(TickType_t *wake, TickType_t ticks)
+{
+    *wake += ticks;
+    TickType_t now = xTaskGetTickCount();
+    if ((int32_t)(*wake - now) > 0)
+    {
+        vTaskDelay(*wake - now);
+    }
+}
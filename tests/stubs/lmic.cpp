@@ -0,0 +1,538 @@
+/*
+ *  Host model of the LMiC calls declared in stubs/lmic.h.
+ */
+
+/* Includes */
+#include "lmic.h"
+#include "_crypto.h"
+
+/* Definitions */
+#define LMIC_MOCK_JOBS              16
+#define LMIC_MOCK_DEVADDR           0x26000001
+#define LMIC_MOCK_AIRTIME_MS        60      /* Every frame, the model has no data rates */
+#define LMIC_MOCK_JOIN_DELAY1_MS    5000    /* LoRaWAN JOIN_ACCEPT_DELAY1 */
+#define LMIC_MOCK_JOIN_RETRY_MS     2000    /* After RX2 of a join request without answer */
+
+/* Variables */
+lmic_t     LMIC;
+lmicMock_t lmicMock;
+
+static osjob_t *lmicMockJobs[LMIC_MOCK_JOBS];
+
+/* Radio model, used once lmicMockConnect() has set the network hooks */
+static osjob_t lmicMockRadioJob;
+static u1_t    lmicMockRadioFrame[MAX_LEN_FRAME];
+static u1_t    lmicMockRadioLen;
+static bool    lmicMockRadioJoin;
+static u4_t    lmicMockRadioTxEndMs;
+static u1_t    lmicMockNwkSKey[16];
+static u1_t    lmicMockAppSKey[16];
+
+static void lmicMockRadioStart();
+
+/* Functions */
+ostime_t os_getTime()
+{
+    return us2osticks(micros());
+}
+
+void os_init()
+{
+}
+
+void os_clearCallback(osjob_t *job)
+{
+    for (u1_t i = 0; i < LMIC_MOCK_JOBS; i++)
+    {
+        if (lmicMockJobs[i] == job)
+        {
+            lmicMockJobs[i] = NULL;
+        }
+    }
+}
+
+void os_setTimedCallback(osjob_t *job, ostime_t time, osjobcb_t cb)
+{
+    /* Same as LMiC: a job is in the queue at most once */
+    os_clearCallback(job);
+    job->deadline = time;
+    job->func     = cb;
+
+    for (u1_t i = 0; i < LMIC_MOCK_JOBS; i++)
+    {
+        if (lmicMockJobs[i] == NULL)
+        {
+            lmicMockJobs[i] = job;
+            return;
+        }
+    }
+    printf(" [FAIL] lmic mock: job queue full\n");
+    abort();
+}
+
+void os_setCallback(osjob_t *job, osjobcb_t cb)
+{
+    os_setTimedCallback(job, os_getTime(), cb);
+}
+
+/* Runs the earliest job that is due, if any */
+void os_runloop_once()
+{
+    ostime_t now  = os_getTime();
+    int      next = -1;
+
+    for (u1_t i = 0; i < LMIC_MOCK_JOBS; i++)
+    {
+        if (lmicMockJobs[i] != NULL && lmicMockJobs[i]->deadline - now <= 0
+            && (next < 0 || lmicMockJobs[i]->deadline - lmicMockJobs[next]->deadline < 0))
+        {
+            next = i;
+        }
+    }
+
+    if (next >= 0)
+    {
+        osjob_t *job = lmicMockJobs[next];
+        lmicMockJobs[next] = NULL;
+        job->func(job);
+    }
+}
+
+void LMIC_reset()
+{
+    os_clearCallback(&lmicMockRadioJob);
+    memset(&LMIC, 0, sizeof(LMIC));
+    LMIC.datarate = DR_SF7;
+    LMIC.rxDelay  = 1;
+}
+
+int LMIC_startJoining()
+{
+    if (LMIC.devaddr != 0 || (LMIC.opmode & OP_JOINING))
+    {
+        return 0;
+    }
+    LMIC.opmode |= OP_JOINING;
+    lmicMock.joinsStarted++;
+    onEvent(EV_JOINING);
+    lmicMockRadioStart();
+    return 1;
+}
+
+void LMIC_shutdown()
+{
+    LMIC.opmode |= OP_SHUTDOWN;
+}
+
+int LMIC_setTxData2(u1_t port, xref2u1_t data, u1_t dlen, u1_t confirmed)
+{
+    if (dlen > MAX_LEN_FRAME)
+    {
+        return -2;
+    }
+    if (data != NULL)
+    {
+        memcpy(LMIC.pendTxData, data, dlen);
+    }
+    LMIC.pendTxPort = port;
+    LMIC.pendTxLen  = dlen;
+    LMIC.pendTxConf = confirmed;
+    LMIC.opmode    |= OP_TXDATA;
+    lmicMock.framesQueued++;
+
+    /* Not joined: the frame waits for the join LMiC starts here */
+    if (LMIC.devaddr == 0)
+    {
+        LMIC_startJoining();
+    }
+    lmicMockRadioStart();
+    return 0;
+}
+
+void LMIC_clrTxData()
+{
+    LMIC.opmode   &= ~(OP_TXDATA | OP_TXRXPEND | OP_POLL);
+    LMIC.pendTxLen = 0;
+}
+
+void LMIC_setSession(u4_t netid, devaddr_t devaddr, xref2u1_t nwkKey, xref2u1_t artKey)
+{
+    LMIC.netid   = netid;
+    LMIC.devaddr = devaddr;
+    LMIC.opmode &= ~OP_JOINING;
+
+    if (nwkKey != NULL && artKey != NULL)
+    {
+        memcpy(lmicMockNwkSKey, nwkKey, 16);
+        memcpy(lmicMockAppSKey, artKey, 16);
+    }
+}
+
+void LMIC_getSessionKeys(u4_t *netid, devaddr_t *devaddr, xref2u1_t nwkKey, xref2u1_t artKey)
+{
+    *netid   = LMIC.netid;
+    *devaddr = LMIC.devaddr;
+    memcpy(nwkKey, lmicMockNwkSKey, 16);
+    memcpy(artKey, lmicMockAppSKey, 16);
+}
+
+void LMIC_setAdrMode(bit_t enabled) {}
+void LMIC_setLinkCheckMode(bit_t enabled) {}
+void LMIC_setClockError(u2_t error) {}
+
+void LMIC_setDrTxpow(dr_t dr, s1_t txpow)
+{
+    LMIC.datarate = dr;
+    LMIC.txpow    = txpow;
+}
+
+void LMIC_setSeqnoUp(u4_t seqno)
+{
+    LMIC.seqnoUp = seqno;
+}
+
+void LMIC_setSeqnoDn(u4_t seqno)
+{
+    LMIC.seqnoDn = seqno;
+}
+
+void LMIC_disableSubBand(u1_t band)
+{
+    if (band < 9)
+    {
+        lmicMock.enabledChannels[band] = 0;
+    }
+}
+
+void LMIC_enableSubBand(u1_t band)
+{
+    if (band < 9)
+    {
+        lmicMock.enabledChannels[band] = 0xFF;
+    }
+}
+
+void LMIC_disableChannel(u1_t channel)
+{
+    if (channel < 72)
+    {
+        lmicMock.enabledChannels[channel / 8] &= ~(1 << (channel % 8));
+    }
+}
+
+void LMIC_enableChannel(u1_t channel)
+{
+    if (channel < 72)
+    {
+        lmicMock.enabledChannels[channel / 8] |= 1 << (channel % 8);
+    }
+}
+
+/* Radio model */
+static void lmicMockPut32(u1_t *buf, u4_t value)
+{
+    buf[0] = (u1_t)(value);
+    buf[1] = (u1_t)(value >> 8);
+    buf[2] = (u1_t)(value >> 16);
+    buf[3] = (u1_t)(value >> 24);
+}
+
+static u4_t lmicMockGet32(const u1_t *buf)
+{
+    return (u4_t)buf[0] | ((u4_t)buf[1] << 8) | ((u4_t)buf[2] << 16) | ((u4_t)buf[3] << 24);
+}
+
+/* MHDR | AppEUI | DevEUI | DevNonce | MIC, with the keys the sketch hands to LMiC */
+static u1_t lmicMockJoinRequest(u1_t *frame)
+{
+    u1_t appKey[16];
+    u1_t mac[AES_BLOCK_SIZE];
+
+    lmicMock.devNonce++;
+    frame[0] = 0x00;
+    os_getArtEui(&frame[1]);
+    os_getDevEui(&frame[9]);
+    frame[17] = (u1_t)(lmicMock.devNonce);
+    frame[18] = (u1_t)(lmicMock.devNonce >> 8);
+
+    os_getDevKey(appKey);
+    aesCmac(appKey, frame, 19, mac);
+    memcpy(&frame[19], mac, 4);
+    return 23;
+}
+
+/* MHDR | DevAddr | FCtrl | FCnt | FPort | FRMPayload | MIC */
+static u1_t lmicMockDataUplink(u1_t *frame)
+{
+    u1_t len = 0;
+
+    frame[len++] = LMIC.pendTxConf ? 0x80 : 0x40;
+    lmicMockPut32(&frame[len], LMIC.devaddr);
+    len += 4;
+    frame[len++] = 0x00;
+    frame[len++] = (u1_t)(LMIC.seqnoUp);
+    frame[len++] = (u1_t)(LMIC.seqnoUp >> 8);
+    frame[len++] = LMIC.pendTxPort;
+    memcpy(&frame[len], LMIC.pendTxData, LMIC.pendTxLen);
+    aesLoRaWANPayload(lmicMockAppSKey, LMIC.devaddr, LMIC.seqnoUp, 0, &frame[len], LMIC.pendTxLen);
+    len += LMIC.pendTxLen;
+    lmicMockPut32(&frame[len], aesLoRaWANMic(lmicMockNwkSKey, LMIC.devaddr, LMIC.seqnoUp, 0, frame, len));
+    return len + 4;
+}
+
+/* Join accept: keys, DevAddr and RX1 delay of the new session */
+static bool lmicMockJoinAcceptFrame(u1_t *frame, u1_t len)
+{
+    u1_t appKey[16];
+    u1_t mac[AES_BLOCK_SIZE];
+
+    if (len != 17 || frame[0] != 0x20)
+    {
+        return false;
+    }
+
+    /* The network decrypted it, the node encrypts, as LMiC does */
+    os_getDevKey(appKey);
+    aesEncryptBlock(appKey, &frame[1], &frame[1]);
+    aesCmac(appKey, frame, 13, mac);
+    if (memcmp(mac, &frame[13], 4) != 0)
+    {
+        return false;
+    }
+
+    u1_t block[AES_BLOCK_SIZE] = {0};
+    memcpy(&block[1], &frame[1], 6);
+    block[7] = (u1_t)(lmicMock.devNonce);
+    block[8] = (u1_t)(lmicMock.devNonce >> 8);
+    block[0] = 0x01;
+    aesEncryptBlock(appKey, block, lmicMockNwkSKey);
+    block[0] = 0x02;
+    aesEncryptBlock(appKey, block, lmicMockAppSKey);
+
+    LMIC.netid   = frame[4] | ((u4_t)frame[5] << 8) | ((u4_t)frame[6] << 16);
+    LMIC.devaddr = lmicMockGet32(&frame[7]);
+    LMIC.rxDelay = (frame[12] & 0x0F) ? (frame[12] & 0x0F) : 1;
+    LMIC.seqnoUp = 0;
+    LMIC.seqnoDn = 0;
+    return true;
+}
+
+/* Data downlink: MIC, then FRMPayload decrypted in LMIC.frame with dataBeg/dataLen as LMiC leaves them */
+static bool lmicMockDataDownlink(const u1_t *frame, u1_t len, u1_t window)
+{
+    u1_t mType = frame[0] & 0xE0;
+    if (len < 12 || (mType != 0x60 && mType != 0xA0) || lmicMockGet32(&frame[1]) != LMIC.devaddr)
+    {
+        return false;
+    }
+
+    u4_t fCnt = (LMIC.seqnoDn & 0xFFFF0000) | frame[6] | ((u4_t)frame[7] << 8);
+    if (aesLoRaWANMic(lmicMockNwkSKey, LMIC.devaddr, fCnt, 1, frame, len - 4) != lmicMockGet32(&frame[len - 4]))
+    {
+        return false;
+    }
+    LMIC.seqnoDn = fCnt + 1;
+
+    memcpy(LMIC.frame, frame, len);
+    LMIC.txrxFlags = (window == 1 ? TXRX_DNW1 : TXRX_DNW2) | ((frame[5] & 0x20) ? TXRX_ACK : 0);
+
+    u1_t portIndex = 8 + (frame[5] & 0x0F);
+    if (portIndex < len - 4)
+    {
+        u1_t port = frame[portIndex];
+        LMIC.dataBeg    = portIndex + 1;
+        LMIC.dataLen    = len - 4 - LMIC.dataBeg;
+        LMIC.txrxFlags |= TXRX_PORT;
+        aesLoRaWANPayload(port == 0 ? lmicMockNwkSKey : lmicMockAppSKey, LMIC.devaddr, fCnt, 1, &LMIC.frame[LMIC.dataBeg], LMIC.dataLen);
+    }
+    else
+    {
+        LMIC.dataBeg    = portIndex;
+        LMIC.dataLen    = 0;
+        LMIC.txrxFlags |= TXRX_NOPORT;
+    }
+    lmicMock.downlinks++;
+    return true;
+}
+
+static void lmicMockTxFunc(osjob_t *job);
+
+/* Opens a receive window, returns true when the exchange is over */
+static bool lmicMockReceive(u1_t window)
+{
+    u1_t frame[MAX_LEN_FRAME];
+    u1_t len = lmicMock.rxWindow(millis(), frame);
+
+    if (lmicMockRadioJoin)
+    {
+        if (len > 0 && lmicMockJoinAcceptFrame(frame, len))
+        {
+            LMIC.opmode &= ~(OP_JOINING | OP_TXRXPEND);
+            onEvent(EV_JOINED);
+            lmicMockRadioStart();
+            return true;
+        }
+        if (window == 1)
+        {
+            return false;
+        }
+
+        /* No join accept: LMiC tries again by itself */
+        LMIC.opmode &= ~OP_TXRXPEND;
+        onEvent(EV_JOIN_TXCOMPLETE);
+        if (LMIC.opmode & OP_JOINING)
+        {
+            os_setTimedCallback(&lmicMockRadioJob, os_getTime() + ms2osticks(LMIC_MOCK_JOIN_RETRY_MS), lmicMockTxFunc);
+        }
+        return true;
+    }
+
+    LMIC.txrxFlags = 0;
+    LMIC.dataLen   = 0;
+    if (!(len > 0 && lmicMockDataDownlink(frame, len, window)) && window == 1)
+    {
+        return false;
+    }
+
+    LMIC.opmode &= ~OP_TXRXPEND;
+    onEvent(EV_TXCOMPLETE);
+    lmicMockRadioStart();
+    return true;
+}
+
+static void lmicMockRx2Func(osjob_t *job)
+{
+    lmicMockReceive(2);
+}
+
+static void lmicMockRx1Func(osjob_t *job)
+{
+    if (!lmicMockReceive(1))
+    {
+        os_setTimedCallback(&lmicMockRadioJob, os_getTime() + ms2osticks(1000), lmicMockRx2Func);
+    }
+}
+
+/* End of the transmission: the network hears the frame, RX1 opens after the delay */
+static void lmicMockTxEndFunc(osjob_t *job)
+{
+    lmicMock.uplink(lmicMockRadioFrame, lmicMockRadioLen, lmicMockRadioTxEndMs);
+
+    u4_t delayMs = lmicMockRadioJoin ? LMIC_MOCK_JOIN_DELAY1_MS : (LMIC.rxDelay ? LMIC.rxDelay : 1) * 1000UL;
+    os_setTimedCallback(&lmicMockRadioJob, os_getTime() + ms2osticks(delayMs), lmicMockRx1Func);
+}
+
+/* Start of a transmission: join request while joining, else the queued frame */
+static void lmicMockTxFunc(osjob_t *job)
+{
+    if (LMIC.opmode & (OP_TXRXPEND | OP_SHUTDOWN))
+    {
+        return;
+    }
+
+    lmicMockRadioJoin = (LMIC.opmode & OP_JOINING) != 0;
+    if (lmicMockRadioJoin)
+    {
+        lmicMockRadioLen = lmicMockJoinRequest(lmicMockRadioFrame);
+        lmicMock.joinRequests++;
+    }
+    else if (LMIC.devaddr != 0 && (LMIC.opmode & OP_TXDATA))
+    {
+        lmicMockRadioLen = lmicMockDataUplink(lmicMockRadioFrame);
+        LMIC.opmode &= ~OP_TXDATA;
+        LMIC.seqnoUp++;
+
+        lmicMock.framesSent++;
+        lmicMock.lastPort = LMIC.pendTxPort;
+        lmicMock.lastLen  = LMIC.pendTxLen;
+        memcpy(lmicMock.lastData, LMIC.pendTxData, LMIC.pendTxLen);
+    }
+    else
+    {
+        return;
+    }
+
+    LMIC.opmode |= OP_TXRXPEND;
+    lmicMockRadioTxEndMs = millis() + LMIC_MOCK_AIRTIME_MS;
+    os_setTimedCallback(&lmicMockRadioJob, os_getTime() + ms2osticks(LMIC_MOCK_AIRTIME_MS), lmicMockTxEndFunc);
+}
+
+/* Something to send and the radio is idle: transmit from the job queue, as LMiC does */
+static void lmicMockRadioStart()
+{
+    if (lmicMock.uplink == NULL || (LMIC.opmode & (OP_TXRXPEND | OP_SHUTDOWN)))
+    {
+        return;
+    }
+    if ((LMIC.opmode & OP_JOINING) || (LMIC.devaddr != 0 && (LMIC.opmode & OP_TXDATA)))
+    {
+        os_setCallback(&lmicMockRadioJob, lmicMockTxFunc);
+    }
+}
+
+/* Test control */
+void lmicMockReset()
+{
+    memset(lmicMockJobs, 0, sizeof(lmicMockJobs));
+    memset(&lmicMock, 0, sizeof(lmicMock));
+    memset(lmicMockNwkSKey, 0, sizeof(lmicMockNwkSKey));
+    memset(lmicMockAppSKey, 0, sizeof(lmicMockAppSKey));
+    LMIC_reset();
+    arduinoResetClock();
+}
+
+/* Puts a network on the air: every frame goes to uplink(), every receive window asks rxWindow() */
+void lmicMockConnect(u1_t (*uplink)(const u1_t *frame, u1_t len, u4_t txEndMs), u1_t (*rxWindow)(u4_t openMs, u1_t *buffer))
+{
+    lmicMock.uplink   = uplink;
+    lmicMock.rxWindow = rxWindow;
+    lmicMockRadioStart();
+}
+
+/* Advances the virtual clock by ms, running every job due on the way in deadline order */
+void lmicMockRunFor(u4_t ms)
+{
+    uint64_t end = (uint64_t)micros() + (uint64_t)ms * 1000;
+
+    while ((uint64_t)micros() < end)
+    {
+        os_runloop_once();
+        arduinoAdvanceUs(1000);
+    }
+}
+
+/* Without a network: join accept received, EV_JOINED, then the queued frame goes out as in LMiC */
+bool lmicMockJoinAccept()
+{
+    if (!(LMIC.opmode & OP_JOINING))
+    {
+        return false;
+    }
+    LMIC.opmode  &= ~OP_JOINING;
+    LMIC.devaddr  = LMIC_MOCK_DEVADDR;
+    LMIC.seqnoUp  = 0;
+    onEvent(EV_JOINED);
+    lmicMockTransmit();
+    return true;
+}
+
+/* Without a network: sends the queued frame, if joined, and reports EV_TXCOMPLETE */
+bool lmicMockTransmit()
+{
+    if (LMIC.devaddr == 0 || !(LMIC.opmode & OP_TXDATA))
+    {
+        return false;
+    }
+    LMIC.opmode &= ~(OP_TXDATA | OP_TXRXPEND);
+    LMIC.seqnoUp++;
+    LMIC.txrxFlags = 0;
+    LMIC.dataLen   = 0;
+
+    lmicMock.framesSent++;
+    lmicMock.lastPort = LMIC.pendTxPort;
+    lmicMock.lastLen  = LMIC.pendTxLen;
+    memcpy(lmicMock.lastData, LMIC.pendTxData, LMIC.pendTxLen);
+
+    onEvent(EV_TXCOMPLETE);
+    return true;
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+/*
+ *  Host stand-in for MCCI LMiC: the types and calls used by the sketch and a
+ *  small model of the MAC behind them (see lmic.cpp).
+ *
+ *  Modelled: the job queue on the virtual clock, OP_JOINING / OP_TXDATA,
+ *  LMIC_reset() dropping the queued frame, LMIC_setTxData2() starting a join
+ *  when not joined. Two ways to drive the radio:
+ *
+ *  - by hand: the test decides when a join accept arrives (lmicMockJoinAccept)
+ *    and when the queued frame goes out (lmicMockTransmit);
+ *  - against a network (lmicMockConnect, e.g. _network_server.h): join
+ *    requests and data frames are built and encrypted with the keys from
+ *    os_getDevKey()/the session, handed to uplink() at the end of the
+ *    airtime, and RX1/RX2 ask rxWindow() at the time they open. Join
+ *    accepts and downlinks are checked (MIC) and decrypted into LMIC.frame.
+ *
+ *  Both report the same events as LMiC.
+ */
+
+/* Includes */
+#include "Arduino.h"
+
+/* Types */
+typedef uint8_t     u1_t;
+typedef int8_t      s1_t;
+typedef uint16_t    u2_t;
+typedef int16_t     s2_t;
+typedef uint32_t    u4_t;
+typedef int32_t     s4_t;
+typedef int32_t     ostime_t;
+typedef u4_t        devaddr_t;
+typedef u1_t        dr_t;
+typedef u2_t        rps_t;
+typedef u1_t        bit_t;
+typedef u1_t       *xref2u1_t;
+typedef const u1_t *xref2cu1_t;
+
+struct osjob_t;
+typedef void (*osjobcb_t)(osjob_t *);
+struct osjob_t
+{
+    osjob_t   *next;
+    ostime_t   deadline;
+    osjobcb_t  func;
+};
+
+typedef enum
+{
+    EV_SCAN_TIMEOUT = 1, EV_BEACON_FOUND, EV_BEACON_MISSED, EV_BEACON_TRACKED, EV_JOINING,
+    EV_JOINED, EV_RFU1, EV_JOIN_FAILED, EV_REJOIN_FAILED, EV_TXCOMPLETE, EV_LOST_TSYNC,
+    EV_RESET, EV_RXCOMPLETE, EV_LINK_DEAD, EV_LINK_ALIVE, EV_SCAN_FOUND, EV_TXSTART,
+    EV_TXCANCELED, EV_RXSTART, EV_JOIN_TXCOMPLETE
+} ev_t;
+
+enum { DR_SF12 = 0, DR_SF11, DR_SF10, DR_SF9, DR_SF8, DR_SF7, DR_SF8C, DR_NONE, DR_SF12CR };
+
+enum
+{
+    OP_NONE = 0x0000, OP_SCAN = 0x0001, OP_TRACK = 0x0002, OP_JOINING = 0x0004, OP_TXDATA = 0x0008,
+    OP_POLL = 0x0010, OP_REJOIN = 0x0020, OP_SHUTDOWN = 0x0040, OP_TXRXPEND = 0x0080, OP_RNDTX = 0x0100,
+    OP_PINGINI = 0x0200, OP_PINGABLE = 0x0400, OP_NEXTCHNL = 0x0800, OP_LINKDEAD = 0x1000,
+    OP_TESTMODE = 0x2000, OP_UNJOIN = 0x4000
+};
+
+enum { TXRX_ACK = 0x80, TXRX_NACK = 0x40, TXRX_NOPORT = 0x20, TXRX_PORT = 0x10, TXRX_PING = 0x04, TXRX_DNW2 = 0x02, TXRX_DNW1 = 0x01 };
+
+/* Definitions */
+#define MAX_LEN_FRAME               64
+#define MAX_CLOCK_ERROR             65536
+#define LMIC_UNUSED_PIN             0xFF
+#define OSTICKS_PER_SEC             62500
+#define ms2osticks(ms)              ((ostime_t)(((int64_t)(ms) * OSTICKS_PER_SEC) / 1000))
+#define sec2osticks(s)              ((ostime_t)((int64_t)(s) * OSTICKS_PER_SEC))
+#define us2osticks(us)              ((ostime_t)(((int64_t)(us) * OSTICKS_PER_SEC) / 1000000))
+#define osticks2ms(t)               ((s4_t)(((int64_t)(t) * 1000) / OSTICKS_PER_SEC))
+
+struct lmic_t
+{
+    u2_t      opmode;
+    u4_t      netid;
+    devaddr_t devaddr;
+    u4_t      seqnoUp;
+    u4_t      seqnoDn;
+    u4_t      freq;
+    s1_t      txpow;
+    dr_t      datarate;
+    dr_t      dn2Dr;
+    u1_t      rxDelay;
+    u1_t      txChnl;
+    u1_t      txCnt;
+    rps_t     rps;
+    s2_t      rssi;
+    s1_t      snr;
+    u1_t      txrxFlags;
+    u1_t      dataBeg;
+    u1_t      dataLen;
+    u1_t      frame[MAX_LEN_FRAME];
+    u1_t      pendTxPort;
+    u1_t      pendTxConf;
+    u1_t      pendTxLen;
+    u1_t      pendTxData[MAX_LEN_FRAME];
+};
+
+struct lmic_pinmap
+{
+    u1_t nss;
+    u1_t rxtx;
+    u1_t rst;
+    u1_t dio[3];
+};
+
+/* Variables */
+extern lmic_t LMIC;
+
+/* Functions */
+void     os_init();
+void     os_runloop_once();
+ostime_t os_getTime();
+void     os_setCallback(osjob_t *job, osjobcb_t cb);
+void     os_setTimedCallback(osjob_t *job, ostime_t time, osjobcb_t cb);
+void     os_clearCallback(osjob_t *job);
+
+void LMIC_reset();
+int  LMIC_startJoining();
+void LMIC_shutdown();
+int  LMIC_setTxData2(u1_t port, xref2u1_t data, u1_t dlen, u1_t confirmed);
+void LMIC_clrTxData();
+void LMIC_setSession(u4_t netid, devaddr_t devaddr, xref2u1_t nwkKey, xref2u1_t artKey);
+void LMIC_getSessionKeys(u4_t *netid, devaddr_t *devaddr, xref2u1_t nwkKey, xref2u1_t artKey);
+void LMIC_setAdrMode(bit_t enabled);
+void LMIC_setDrTxpow(dr_t dr, s1_t txpow);
+void LMIC_setLinkCheckMode(bit_t enabled);
+void LMIC_setClockError(u2_t error);
+void LMIC_setSeqnoUp(u4_t seqno);
+void LMIC_setSeqnoDn(u4_t seqno);
+void LMIC_disableSubBand(u1_t band);
+void LMIC_enableSubBand(u1_t band);
+void LMIC_disableChannel(u1_t channel);
+void LMIC_enableChannel(u1_t channel);
+
+/* Provided by the sketch */
+void onEvent(ev_t ev);
+void os_getArtEui(u1_t *buf);
+void os_getDevEui(u1_t *buf);
+void os_getDevKey(u1_t *buf);
+
+/* Test control */
+typedef struct
+{
+    u4_t joinsStarted;          /* LMIC_startJoining(), direct or from LMIC_setTxData2() */
+    u4_t framesQueued;          /* LMIC_setTxData2() */
+    u4_t framesSent;            /* lmicMockTransmit() or the radio */
+    u4_t joinRequests;          /* Radio only */
+    u4_t downlinks;             /* Radio only, with a valid MIC */
+    u2_t devNonce;              /* Of the last join request */
+    u1_t lastPort;
+    u1_t lastLen;
+    u1_t lastData[MAX_LEN_FRAME];
+    u1_t enabledChannels[9];    /* Bitmap of the 72 AU915 uplink channels */
+    u1_t (*uplink)(const u1_t *frame, u1_t len, u4_t txEndMs);
+    u1_t (*rxWindow)(u4_t openMs, u1_t *buffer);
+} lmicMock_t;
+
+extern lmicMock_t lmicMock;
+
+void lmicMockReset();
+void lmicMockRunFor(u4_t ms);
+void lmicMockConnect(u1_t (*uplink)(const u1_t *frame, u1_t len, u4_t txEndMs), u1_t (*rxWindow)(u4_t openMs, u1_t *buffer));
+bool lmicMockJoinAccept();
+bool lmicMockTransmit();
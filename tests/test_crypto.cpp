@@ -0,0 +1,158 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+
+/*
+ *  Known-answer tests of every AES backend compiled on the host (_crypto.h)
+ *  and of the lmic_aes_encrypt() export used with USE_LMIC_AES_HOOK.
+ */
+
+/* As after tools/lmic_aes_hook.sh */
+#define USE_LMIC_AES_HOOK
+#define LMIC_AES_EXTERNAL
+
+/* Includes */
+#include <stdlib.h>
+#include "test.h"
+#include "_crypto.h"
+
+/* RFC 4493, section 4 */
+static const uint8_t testCmacKey[16]     = {0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C};
+static const uint8_t testCmacMessage[64] = {0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96, 0xE9, 0x3D, 0x7E, 0x11, 0x73, 0x93, 0x17, 0x2A,
+                                            0xAE, 0x2D, 0x8A, 0x57, 0x1E, 0x03, 0xAC, 0x9C, 0x9E, 0xB7, 0x6F, 0xAC, 0x45, 0xAF, 0x8E, 0x51,
+                                            0x30, 0xC8, 0x1C, 0x46, 0xA3, 0x5C, 0xE4, 0x11, 0xE5, 0xFB, 0xC1, 0x19, 0x1A, 0x0A, 0x52, 0xEF,
+                                            0xF6, 0x9F, 0x24, 0x45, 0xDF, 0x4F, 0x9B, 0x17, 0xAD, 0x2B, 0x41, 0x7B, 0xE6, 0x6C, 0x37, 0x10};
+static const uint16_t testCmacLength[4]  = {0, 16, 40, 64};
+static const uint8_t testCmacMac[4][16]  = {
+    {0xBB, 0x1D, 0x69, 0x29, 0xE9, 0x59, 0x37, 0x28, 0x7F, 0xA3, 0x7D, 0x12, 0x9B, 0x75, 0x67, 0x46},
+    {0x07, 0x0A, 0x16, 0xB4, 0x6B, 0x4D, 0x41, 0x44, 0xF7, 0x9B, 0xDD, 0x9D, 0xD0, 0x4A, 0x28, 0x7C},
+    {0xDF, 0xA6, 0x67, 0x47, 0xDE, 0x9A, 0xE6, 0x30, 0x30, 0xCA, 0x32, 0x61, 0x14, 0x97, 0xC8, 0x27},
+    {0x51, 0xF0, 0xBE, 0xBF, 0x7E, 0x3B, 0x9D, 0x92, 0xFC, 0x49, 0x74, 0x17, 0x79, 0x36, 0x3C, 0xFE},
+};
+
+/* FIPS-197, appendix C.1 */
+static const uint8_t testFipsKey[16]    = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F};
+static const uint8_t testFipsPlain[16]  = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF};
+static const uint8_t testFipsCipher[16] = {0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30, 0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A};
+
+static void testBackends()
+{
+    uint8_t block[AES_BLOCK_SIZE];
+
+    for (uint8_t i = 0; i < AES_BACKENDS_COUNT; i++)
+    {
+        aesBackends[i].encrypt(testFipsKey, testFipsPlain, block);
+        TEST_CHECK_BYTES(block, testFipsCipher, AES_BLOCK_SIZE);
+    }
+
+    aesDecryptBlock(testFipsKey, testFipsCipher, block);
+    TEST_CHECK_BYTES(block, testFipsPlain, AES_BLOCK_SIZE);
+
+    /* Random keys and blocks, every backend against the reference; key changes every call to defeat the key cache */
+    uint8_t key[AES_BLOCK_SIZE];
+    uint8_t plain[AES_BLOCK_SIZE];
+    uint8_t expected[AES_BLOCK_SIZE];
+    int mismatches = 0;
+
+    srand(1);
+    for (int n = 0; n < 5000; n++)
+    {
+        for (uint8_t i = 0; i < AES_BLOCK_SIZE; i++)
+        {
+            key[i]   = (uint8_t)rand();
+            plain[i] = (uint8_t)rand();
+        }
+        aesReferenceEncryptBlock(key, plain, expected);
+        for (uint8_t i = 0; i < AES_BACKENDS_COUNT; i++)
+        {
+            aesBackends[i].encrypt(key, plain, block);
+            mismatches += memcmp(block, expected, AES_BLOCK_SIZE) != 0;
+        }
+        aesDecryptBlock(key, expected, block);
+        mismatches += memcmp(block, plain, AES_BLOCK_SIZE) != 0;
+    }
+    TEST_CHECK(mismatches == 0);
+
+    /* In place, as LMiC calls it */
+    memcpy(block, testFipsPlain, AES_BLOCK_SIZE);
+    aesEncryptBlock(testFipsKey, block, block);
+    TEST_CHECK_BYTES(block, testFipsCipher, AES_BLOCK_SIZE);
+}
+
+static void testCmac()
+{
+    uint8_t mac[AES_BLOCK_SIZE];
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        aesCmac(testCmacKey, testCmacMessage, testCmacLength[i], mac);
+        TEST_CHECK_BYTES(mac, testCmacMac[i], AES_BLOCK_SIZE);
+    }
+}
+
+static void testLmicHook()
+{
+    uint8_t key[AES_BLOCK_SIZE];
+    uint8_t block[AES_BLOCK_SIZE];
+
+    memcpy(key, testFipsKey, AES_BLOCK_SIZE);
+    memcpy(block, testFipsPlain, AES_BLOCK_SIZE);
+    lmic_aes_encrypt(block, key);
+    TEST_CHECK_BYTES(block, testFipsCipher, AES_BLOCK_SIZE);
+    TEST_CHECK_BYTES(key, testFipsKey, AES_BLOCK_SIZE);
+}
+
+int main()
+{
+    testBackends();
+    testCmac();
+    testLmicHook();
+
+    /* FIPS-197, RFC 4493 and the TTN join/uplink capture */
+    TEST_CHECK(aesSelfTest());
+
+    return testResult("crypto");
+}
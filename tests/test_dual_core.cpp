@@ -0,0 +1,297 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+/*
+ *  Dual core mode (_dual_core.h, _spsc.h) with a std::thread per FreeRTOS
+ *  task (stubs/freertos.cpp): the SPSC queue between the cores, metertask()
+ *  and samplefunc() of the sketch feeding the energy accumulator on the LMiC
+ *  core only, and the per-task log lines of DEBUG_PORT.
+ */
+
+/* Includes */
+#include <atomic>
+#include <lmic.h>
+#include "test.h"
+#include "_configurations.h"
+
+#define USE_DUAL_CORE
+
+#include "_dual_core.h"
+#include "_meter.h"
+#include "_energy.h"
+
+/* Definitions */
+#define TEST_ITEMS          500000
+#define TEST_READINGS       20000
+#define TEST_LOG_LINES      300
+#define TEST_LOGGERS        DUAL_CORE_LOG_PRODUCERS
+
+/* Types */
+typedef struct
+{
+    uint32_t sequence;
+    uint32_t check;
+} testItem_t;
+
+/* Variables */
+static spscQueue<testItem_t, 64> testQueue;
+static std::atomic<bool>     testProducerDone(false);
+static std::atomic<bool>     testConsumerDone(false);
+static std::atomic<uint32_t> testWrongItems(0);
+
+static std::atomic<bool>     testMeterDone(false);
+static std::atomic<bool>     testSampleDone(false);
+static std::atomic<uint32_t> testWrongCore(0);
+static uint32_t              testSampled;
+static uint32_t              testFirstEnergy;
+static uint32_t              testLastEnergy;
+static bool                  testOrdered = true;
+
+static std::atomic<uint8_t>  testLoggersDone(0);
+
+/* Functions */
+/* No LMiC run loop or network here */
+void onEvent(ev_t ev) {}
+void os_getArtEui(u1_t *buf) {}
+void os_getDevEui(u1_t *buf) {}
+void os_getDevKey(u1_t *buf) {}
+
+/* Tasks return when done, a FreeRTOS task would vTaskDelete(NULL) */
+static void testProducerTask(void *parameter)
+{
+    for (uint32_t i = 0; i < TEST_ITEMS; )
+    {
+        testItem_t item = {i, (uint32_t)(i * 2654435761UL)};
+        if (testQueue.push(item))
+        {
+            i++;
+        }
+        else
+        {
+            vTaskDelay(0);
+        }
+    }
+    testProducerDone = true;
+}
+
+static void testConsumerTask(void *parameter)
+{
+    testItem_t item;
+
+    for (uint32_t expected = 0; expected < TEST_ITEMS; )
+    {
+        if (!testQueue.pop(&item))
+        {
+            vTaskDelay(0);
+            continue;
+        }
+        testWrongItems += (item.sequence != expected || item.check != (uint32_t)(expected * 2654435761UL));
+        expected++;
+    }
+    testConsumerDone = true;
+}
+
+/* Every item across the cores, in order and intact */
+static void testQueueAcrossCores()
+{
+    xTaskCreatePinnedToCore(testConsumerTask, "consumer", 4096, NULL, 1, NULL, DUAL_CORE_LMIC_CORE);
+    xTaskCreatePinnedToCore(testProducerTask, "producer", 4096, NULL, 1, NULL, DUAL_CORE_WORKER_CORE);
+
+    while (!testProducerDone || !testConsumerDone)
+    {
+        vTaskDelay(1);
+    }
+    TEST_CHECK(testWrongItems == 0);
+}
+
+/* metertask(): reads only, drops when the queue is full */
+static void testMeterTask(void *parameter)
+{
+    meterReading_t reading;
+    memset(&reading, 0, sizeof(reading));
+
+    for (uint32_t i = 0; i < TEST_READINGS; i++)
+    {
+        reading.valid  = (i % 50 != 7);     /* Meter without voltage now and then */
+        reading.energy = 1000 + 3 * i;
+        meterQueue.push(reading);
+        if (i % 4 == 0)
+        {
+            vTaskDelay(0);
+        }
+    }
+    testMeterDone = true;
+}
+
+/* samplefunc(): runs the accumulator, holds the queue while a TX/RX is pending */
+static void testSampleTask(void *parameter)
+{
+    meterReading_t reading;
+    uint32_t passes = 0;
+
+    while (!testMeterDone || meterQueue.head.load() != meterQueue.tail.load())
+    {
+        LMIC.opmode = (passes++ % 64 < 16) ? OP_TXRXPEND : 0;
+
+        while (!(LMIC.opmode & OP_TXRXPEND) && meterQueue.pop(&reading))
+        {
+            testWrongCore += (xPortGetCoreID() != DUAL_CORE_LMIC_CORE);
+            if (reading.valid)
+            {
+                if (testSampled == 0)
+                {
+                    testFirstEnergy = reading.energy;
+                }
+                testOrdered    = testOrdered && (testSampled == 0 || reading.energy > testLastEnergy);
+                testLastEnergy = reading.energy;
+                testSampled++;
+                energyUpdate(reading.energy);
+            }
+        }
+        vTaskDelay(0);
+    }
+    testSampleDone = true;
+}
+
+/* Whatever the queue dropped, the accumulator ends on the last reading */
+static void testEnergyOnLmicCore()
+{
+    energyBegin();
+    LMIC.opmode = 0;
+
+    xTaskCreatePinnedToCore(testSampleTask, "lmic", DUAL_CORE_LMIC_STACK, NULL, DUAL_CORE_LMIC_PRIORITY, NULL, DUAL_CORE_LMIC_CORE);
+    xTaskCreatePinnedToCore(testMeterTask, "meter", DUAL_CORE_WORKER_STACK, NULL, 1, NULL, DUAL_CORE_WORKER_CORE);
+
+    while (!testSampleDone)
+    {
+        vTaskDelay(1);
+    }
+    TEST_CHECK(testWrongCore == 0);
+    TEST_CHECK(testOrdered);
+    TEST_CHECK(testSampled > 0);
+    TEST_CHECK(energyState.total == testLastEnergy - testFirstEnergy);
+    printf(" [INFO] %-20s: %u valid readings of %u accumulated, %u dropped on a full queue\n", "Meter queue",
+           (unsigned)testSampled, TEST_READINGS, (unsigned)meterQueue.dropped.load());
+}
+
+/* A line built with several print() calls, parameter is the logger number */
+static void testLoggerTask(void *parameter)
+{
+    unsigned logger = (unsigned)(uintptr_t)parameter;
+
+    for (uint32_t n = 0; n < TEST_LOG_LINES; n++)
+    {
+        DEBUG_PORT.print("logger ");
+        DEBUG_PORT.print(logger);
+        DEBUG_PORT.println(" line " + String(n));
+        if (n % 8 == 0)
+        {
+            vTaskDelay(1);
+        }
+    }
+    testLoggersDone++;
+}
+
+/*
+ *  Two loggers on the LMiC core, as setup() and lmictask(), one on the worker
+ *  core: lines never mix across tasks, they come out whole and in order or
+ *  are counted as dropped.
+ */
+static void testLogLines()
+{
+    dualCoreLine_t line;
+    uint32_t next[TEST_LOGGERS] = {0};
+    uint32_t received = 0;
+    uint32_t wrong    = 0;
+
+    for (uintptr_t logger = 0; logger < TEST_LOGGERS; logger++)
+    {
+        BaseType_t core = (logger == 0) ? DUAL_CORE_WORKER_CORE : DUAL_CORE_LMIC_CORE;
+        xTaskCreatePinnedToCore(testLoggerTask, "log", DUAL_CORE_WORKER_STACK, (void *)logger, 1, NULL, core);
+    }
+
+    /* Stands for dualCoreLogTask() */
+    for (;;)
+    {
+        bool finished = (testLoggersDone == TEST_LOGGERS);
+        for (uint8_t i = 0; i < DUAL_CORE_LOG_PRODUCERS; i++)
+        {
+            while (dualCoreLogProducers[i].queue.pop(&line))
+            {
+                unsigned logger, n;
+                if (sscanf(line.text, "logger %u line %u", &logger, &n) != 2 || logger >= TEST_LOGGERS || n < next[logger])
+                {
+                    wrong++;
+                    continue;
+                }
+                next[logger] = n + 1;
+                received++;
+            }
+        }
+        if (finished)
+        {
+            break;
+        }
+        vTaskDelay(1);
+    }
+
+    TEST_CHECK(wrong == 0);
+    TEST_CHECK(dualCoreLogUnregistered == 0);
+    TEST_CHECK(received + dualCoreLogDropped() == TEST_LOGGERS * TEST_LOG_LINES);
+    for (uint8_t logger = 0; logger < TEST_LOGGERS; logger++)
+    {
+        TEST_CHECK(next[logger] == TEST_LOG_LINES);
+    }
+}
+
+int main()
+{
+    testQueueAcrossCores();
+    testEnergyOnLmicCore();
+    testLogLines();
+
+    return testResult("dual_core");
+}
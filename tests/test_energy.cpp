@@ -0,0 +1,270 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+
+/*
+ *  Energy accumulator (_energy.h): counter wrap and meter reset handling,
+ *  byte-for-byte anchor and delta frames, and a server side decoder fed
+ *  with a lossy uplink stream.
+ */
+
+/* Includes */
+#include <lmic.h>
+#include "test.h"
+#include "_configurations.h"
+#include "_energy.h"
+
+/* Server side: last anchor of each id and its frame counter */
+static u4_t testAnchors[ENERGY_ANCHOR_ID_MASK + 1];
+static u4_t testAnchorFCnt[ENERGY_ANCHOR_ID_MASK + 1];
+static bool testAnchorKnown[ENERGY_ANCHOR_ID_MASK + 1];
+static u4_t testLastFCnt;
+
+static void testServerReset()
+{
+    memset(testAnchorKnown, 0, sizeof(testAnchorKnown));
+    testLastFCnt = 0;
+}
+
+/* Returns false if the anchor of the delta was lost */
+static bool testDecode(const u1_t *payload, u1_t len, u4_t fCnt, u4_t *total)
+{
+    /* FCnt went back: new session (rejoin, reboot), the anchors are from the previous one */
+    if (fCnt < testLastFCnt)
+    {
+        memset(testAnchorKnown, 0, sizeof(testAnchorKnown));
+    }
+    testLastFCnt = fCnt;
+
+    if (len == 5)
+    {
+        u1_t id = payload[0] & ENERGY_ANCHOR_ID_MASK;
+        testAnchors[id]     = ((u4_t)payload[1] << 24) | ((u4_t)payload[2] << 16) | ((u4_t)payload[3] << 8) | payload[4];
+        testAnchorFCnt[id]  = fCnt;
+        testAnchorKnown[id] = true;
+        *total = testAnchors[id];
+        return true;
+    }
+
+    u1_t id    = (payload[0] >> 4) & ENERGY_ANCHOR_ID_MASK;
+    u4_t delta = (len == 3) ? ((u4_t)(payload[0] & 0x0F) << 16) | ((u4_t)payload[1] << 8) | payload[2]
+                            : ((u4_t)(payload[0] & 0x0F) << 8) | payload[1];
+    *total = testAnchors[id] + delta;
+
+    /* The anchor with this id went out at most ENERGY_ANCHOR_INTERVAL frames ago, an older one was replaced */
+    return testAnchorKnown[id] && fCnt - testAnchorFCnt[id] <= ENERGY_ANCHOR_INTERVAL;
+}
+
+static void testFrames()
+{
+    u1_t payload[ENERGY_PAYLOAD_MAX];
+
+    energyBegin();
+    TEST_CHECK(energyState.total == 0);
+
+    /* First reading is the reference, boot frame is an anchor */
+    energyUpdate(1000);
+    TEST_CHECK(energyPayload(payload) == 5);
+    static const u1_t anchor[5] = {0x81, 0x00, 0x00, 0x00, 0x00};
+    TEST_CHECK_BYTES(payload, anchor, 5);
+
+    /* 100 Wh: 2 bytes */
+    energyUpdate(1100);
+    TEST_CHECK(energyPayload(payload) == 2);
+    static const u1_t shortDelta[2] = {0x10, 0x64};
+    TEST_CHECK_BYTES(payload, shortDelta, 2);
+
+    /* 4095 Wh still fits 12 bits */
+    energyUpdate(1000 + ENERGY_DELTA_SHORT_MAX);
+    TEST_CHECK(energyPayload(payload) == 2);
+    static const u1_t shortMax[2] = {0x1F, 0xFF};
+    TEST_CHECK_BYTES(payload, shortMax, 2);
+
+    /* 5000 Wh: 3 bytes */
+    energyUpdate(6000);
+    TEST_CHECK(energyPayload(payload) == 3);
+    static const u1_t longDelta[3] = {0x10, 0x13, 0x88};
+    TEST_CHECK_BYTES(payload, longDelta, 3);
+
+    /* Above 20 bits: new anchor, id 2 */
+    energyUpdate(6000 + ENERGY_DELTA_LONG_MAX);
+    TEST_CHECK(energyPayload(payload) == 5);
+    TEST_CHECK(payload[0] == 0x82);
+    TEST_CHECK(energyAnchorTotal == 5000 + ENERGY_DELTA_LONG_MAX);
+
+    /* Requested by downlink */
+    energyUpdate(6010 + ENERGY_DELTA_LONG_MAX);
+    energyRequestAnchor();
+    TEST_CHECK(energyPayload(payload) == 5);
+    TEST_CHECK(payload[0] == 0x83);
+
+    /* Every ENERGY_ANCHOR_INTERVAL frames */
+    u1_t anchors = 0;
+    for (u1_t i = 0; i < ENERGY_ANCHOR_INTERVAL + 1; i++)
+    {
+        anchors += energyPayload(payload) == 5;
+    }
+    TEST_CHECK(anchors == 1);
+}
+
+static void testCounter()
+{
+    energyHasMeter    = true;
+    energyState.total = 1000;
+
+    /* Wrap of the PZEM counter */
+    energyState.lastMeter = ENERGY_METER_WRAP_WH - 100;
+    energyUpdate(50);
+    TEST_CHECK(energyState.total == 1150);
+
+    /* Meter reset: it counted 20 Wh since */
+    energyState.lastMeter = 5000;
+    energyUpdate(20);
+    TEST_CHECK(energyState.total == 1170);
+
+    /* Persisted every ENERGY_PERSIST_STEP_WH */
+    energyPersist();
+    energyUpdate(20 + ENERGY_PERSIST_STEP_WH - 1);
+    TEST_CHECK(energyPersistedTotal == 1170);
+    energyUpdate(20 + ENERGY_PERSIST_STEP_WH);
+    TEST_CHECK(energyPersistedTotal == 1170 + ENERGY_PERSIST_STEP_WH);
+}
+
+/* 3000 uplinks, 30% lost: every frame the server accepts decodes to the exact total */
+static void testLossyStream()
+{
+    u1_t payload[ENERGY_PAYLOAD_MAX];
+    u4_t meter  = 0;
+    u4_t seed   = 12345;
+    u4_t wrong  = 0;
+    u4_t bytes  = 0;
+    u4_t frames = 0;
+
+    testServerReset();
+    energyBegin();
+    energyHasMeter = false;
+    energyUpdate(meter);
+
+    for (u4_t n = 0; n < 3000; n++)
+    {
+        seed   = seed * 1103515245UL + 12345;
+        meter += (seed >> 16) % 300;      /* Up to 300 Wh between uplinks */
+        energyUpdate(meter);
+
+        u1_t len = energyPayload(payload);
+        TEST_CHECK(len == 2 || len == 3 || len == 5);
+
+        if ((seed >> 8) % 10 < 3)
+        {
+            continue;
+        }
+
+        u4_t total;
+        if (testDecode(payload, len, n, &total))
+        {
+            wrong += (total != energyState.total);
+            bytes += len;
+            frames++;
+        }
+    }
+    TEST_CHECK(wrong == 0);
+    TEST_CHECK(frames > 1300);
+    printf(" [INFO] %-20s: %u frames, %.2f bytes on average\n", "Energy uplinks", frames, (double)bytes / frames);
+}
+
+/* Reboot: the boot anchor takes the next id, a delta of the new session never decodes against the old one */
+static void testReboot()
+{
+    u1_t          payload[ENERGY_PAYLOAD_MAX];
+    u4_t          total;
+    energyState_t persisted;
+
+    testServerReset();
+    energyBegin();
+    energyUpdate(energyState.lastMeter);
+    u1_t len = energyPayload(payload);
+    TEST_CHECK(len == 5);
+    TEST_CHECK(testDecode(payload, len, 0, &total));
+    u1_t id = payload[0] & ENERGY_ANCHOR_ID_MASK;
+
+    /* The id survives the restart with the rest of the state */
+    energyPersist();
+    energyBegin();
+    TEST_CHECK(energyPayload(payload) == 5);
+    TEST_CHECK((payload[0] & ENERGY_ANCHOR_ID_MASK) == ((id + 1) & ENERGY_ANCHOR_ID_MASK));
+
+    /* Power cut with a persisted id older than the last anchor: the boot anchor reuses its id */
+    energyPersist();
+    memcpy(&persisted, &energyState, sizeof(persisted));
+    testServerReset();
+    energyRequestAnchor();
+    len = energyPayload(payload);
+    TEST_CHECK(testDecode(payload, len, 0, &total));
+    id = payload[0] & ENERGY_ANCHOR_ID_MASK;
+    TEST_CHECK(testDecode(payload, energyPayload(payload), 1, &total));
+    TEST_CHECK(testDecode(payload, energyPayload(payload), 2, &total));
+
+    memcpy(&energyState, &persisted, sizeof(energyState));
+    energyBegin();
+    energyUpdate(energyState.lastMeter + 50);
+    TEST_CHECK(energyPayload(payload) == 5);
+    TEST_CHECK((payload[0] & ENERGY_ANCHOR_ID_MASK) == id);
+
+    /* FCnt starts over and that anchor is lost: its delta is refused, not added to the old anchor */
+    len = energyPayload(payload);
+    TEST_CHECK(len == 2);
+    TEST_CHECK(!testDecode(payload, len, 1, &total));
+}
+
+int main()
+{
+    testFrames();
+    testCounter();
+    testLossyStream();
+    testReboot();
+
+    return testResult("energy");
+}
@@ -0,0 +1,186 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+
+/*
+ *  Replays a synthetic meter recording through the event detector
+ *  (_events.h) with the thresholds of _configurations.h and checks that
+ *  each disturbance raises its event exactly once, on the expected sample.
+ */
+
+/* Includes */
+#include <lmic.h>
+#include "test.h"
+#include "_configurations.h"
+#include "_events.h"
+
+/* Types */
+typedef struct
+{
+    const char *name;
+    u2_t        samples;
+    u2_t        voltage;        /* 0.1 V, 0 = meter silent */
+    u4_t        power;          /* 0.1 W */
+    u1_t        events;         /* Expected events raised in this segment */
+    u2_t        firstEvent;     /* Sample of the segment that raises them */
+} testSegment_t;
+
+/* 1 sample per second, like METER_SAMPLE_INTERVAL_MS */
+static const testSegment_t testWaveform[] = {
+    {"nominal",             120, 2200,  5000, 0,                 0},
+    {"dip, 2 samples",        2, 1900,  5000, 0,                 0},
+    {"nominal",              30, 2200,  5000, 0,                 0},
+    {"sag, 5 samples",        5, 1900,  5000, EVENT_SAG,         EVENTS_SAG_SWELL_SAMPLES - 1},
+    {"inside hysteresis",    10, 1990,  5000, 0,                 0},
+    {"sag again",            10, 1900,  5000, 0,                 0},
+    {"nominal",              30, 2200,  5000, 0,                 0},
+    {"long sag, 60 s",       60, 1850,  5000, EVENT_SAG,         EVENTS_SAG_SWELL_SAMPLES - 1},
+    {"nominal",              30, 2200,  5000, 0,                 0},
+    {"swell, 4 samples",      4, 2450,  5000, EVENT_SWELL,       EVENTS_SAG_SWELL_SAMPLES - 1},
+    {"nominal",              30, 2200,  5000, 0,                 0},
+    {"overvoltage, 1 sample", 1, 2600,  5000, EVENT_OVERVOLTAGE, 0},
+    {"nominal",              30, 2200,  5000, 0,                 0},
+    {"load step up",         60, 2200, 35000, EVENT_LOAD_SPIKE,  0},
+    {"load step down",       60, 2200,  5000, EVENT_LOAD_SPIKE,  0},
+    {"small load changes",   20, 2200,  9000, 0,                 0},
+    {"outage",               10,    0,     0, EVENT_OUTAGE,      0},
+    {"restore",              60, 2200,  5000, EVENT_RESTORE,     0},
+    {"brownout, 30 V",        3,  300,     0, EVENT_OUTAGE,      0},
+    {"restore",              30, 2200,  5000, EVENT_RESTORE,     0},
+};
+
+#define TEST_SEGMENTS               (sizeof(testWaveform) / sizeof(testWaveform[0]))
+
+/* +/- 0.4 V of noise on every sample, deterministic */
+static u2_t testNoise(u4_t n)
+{
+    return (u2_t)((n * 2654435761UL >> 16) % 9);
+}
+
+static void testReplay()
+{
+    meterReading_t reading;
+    u4_t n = 0;
+
+    memset(&reading, 0, sizeof(reading));
+    for (u1_t s = 0; s < TEST_SEGMENTS; s++)
+    {
+        const testSegment_t *segment = &testWaveform[s];
+        u1_t raised = 0;
+        u2_t raisedCount = 0;
+        int  raisedAt = -1;
+
+        for (u2_t i = 0; i < segment->samples; i++, n++)
+        {
+            reading.valid   = segment->voltage != 0;
+            reading.voltage = segment->voltage ? segment->voltage + testNoise(n) - 4 : 0;
+            reading.power   = segment->power;
+
+            u1_t events = eventsSample(&reading);
+            if (events)
+            {
+                /* Sent right away, as do_send_event() does with airtime left */
+                u1_t payload[EVENTS_PAYLOAD_SIZE];
+                eventsPayload(payload);
+
+                raised |= events;
+                raisedCount++;
+                if (raisedAt < 0)
+                {
+                    raisedAt = i;
+                }
+            }
+        }
+
+        if (raised != segment->events || raisedCount > 1 || (raised && raisedAt != segment->firstEvent))
+        {
+            printf(" [FAIL] %-20s: events x%02X at %d, expected x%02X at %u\n", segment->name, raised, raisedAt, segment->events, segment->firstEvent);
+        }
+        TEST_CHECK(raised == segment->events);
+        TEST_CHECK(raisedCount <= 1);
+    }
+}
+
+static void testPayload()
+{
+    u1_t payload[EVENTS_PAYLOAD_SIZE];
+
+    eventsPending = EVENT_SAG | EVENT_LOAD_SPIKE;
+    eventsVoltage = 1900;
+    eventsPower   = 35000;
+
+    static const u1_t expected[6] = {0x28, 0x07, 0x6C, 0x00, 0x88, 0xB8};
+    TEST_CHECK(eventsPayload(payload) == 6);
+    TEST_CHECK_BYTES(payload, expected, 6);
+    TEST_CHECK(eventsPending == 0);
+}
+
+/* Event uplinks every second for an hour at DR5: the budget plus one hour of refill */
+static void testAirtime()
+{
+    u4_t cost = airtimeMs(5, LORAWAN_OVERHEAD + EVENTS_PAYLOAD_SIZE);
+    u4_t sent = 0;
+
+    eventsAirtimeTokens = EVENTS_AIRTIME_BUDGET_MS;
+    eventsAirtimeLastMs = 0;
+    for (u4_t ms = 0; ms < 3600000UL; ms += 1000)
+    {
+        sent += eventsAirtimeTake(5, ms);
+    }
+
+    TEST_CHECK(cost == 52);        /* SF7BW125, 19 bytes: 50.25 symbols of 1.024 ms */
+    TEST_CHECK(sent * cost <= 2 * EVENTS_AIRTIME_BUDGET_MS);
+    TEST_CHECK(sent * cost > 2 * EVENTS_AIRTIME_BUDGET_MS - 2 * cost);
+}
+
+int main()
+{
+    testReplay();
+    testPayload();
+    testAirtime();
+
+    return testResult("events");
+}
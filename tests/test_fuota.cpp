@@ -0,0 +1,269 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+
+/*
+ *  Fragmented firmware update (_fuota.h) over a RAM flash: a 20 KB image sent
+ *  as plain then TS004 coded fragments with 10, 20 and 30% of them lost.
+ *  fuotaWork() is driven like fuotafunc() does in the sketch, and every step
+ *  must stay within one sector of flash work.
+ */
+
+/* Includes */
+#include <stdlib.h>
+#include "test.h"
+#include "_configurations.h"
+
+#define FUOTA_FLASH_CUSTOM
+
+/* RAM flash: bits only go from 1 to 0 between erases */
+static uint8_t  testFlash[1 << 20];
+static uint32_t testBegun;
+static uint32_t testErases;
+static uint32_t testWriteErrors;
+static uint32_t testStepBytes;          /* Erased or read by the current fuotaWork() step */
+static bool     testActivated;
+
+bool fuotaFlashBegin(uint32_t size)
+{
+    testBegun = size;
+    return size <= sizeof(testFlash);
+}
+
+bool fuotaFlashErase(uint32_t offset, uint32_t len)
+{
+    memset(testFlash + offset, 0xFF, len);
+    testErases++;
+    testStepBytes += len;
+    return offset + len <= testBegun;
+}
+
+bool fuotaFlashWrite(uint32_t offset, const uint8_t *data, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++)
+    {
+        testWriteErrors += (testFlash[offset + i] != 0xFF);
+        testFlash[offset + i] = data[i];
+    }
+    return offset + len <= testBegun;
+}
+
+bool fuotaFlashRead(uint32_t offset, uint8_t *data, uint32_t len)
+{
+    memcpy(data, testFlash + offset, len);
+    testStepBytes += len;
+    return true;
+}
+
+bool fuotaFlashActivate()
+{
+    testActivated = true;
+    return true;
+}
+
+#include "_fuota.h"
+
+/* Definitions */
+#define TEST_IMAGE_SIZE     20000
+#define TEST_FRAG_SIZE      48
+#define TEST_FRAGMENTS      ((TEST_IMAGE_SIZE + TEST_FRAG_SIZE - 1) / TEST_FRAG_SIZE)
+
+/* Variables */
+static uint8_t testImage[TEST_FRAGMENTS * TEST_FRAG_SIZE];
+static uint8_t testParity[FUOTA_MAX_FRAGMENTS / 8];
+
+/* Runs the pending work like fuotafunc(), returns the number of steps */
+static uint32_t testWork()
+{
+    uint32_t steps = 0;
+
+    while (fuotaBusy())
+    {
+        testStepBytes = 0;
+        fuotaWork();
+        TEST_CHECK(testStepBytes <= FUOTA_SECTOR_SIZE);
+        steps++;
+    }
+    return steps;
+}
+
+static uint8_t testSetup(uint32_t crc)
+{
+    uint8_t setup[10] = {FUOTA_CMD_SETUP, TEST_FRAG_SIZE, 0, 0, TEST_IMAGE_SIZE >> 8, TEST_IMAGE_SIZE & 0xFF,
+                         (uint8_t)(crc >> 24), (uint8_t)(crc >> 16), (uint8_t)(crc >> 8), (uint8_t)crc};
+    return fuotaDownlink(setup, sizeof(setup));
+}
+
+/* Fragment n as the server builds it, 1..M plain, M+1.. coded */
+static uint8_t testFragment(uint16_t n, uint8_t *downlink)
+{
+    downlink[0] = FUOTA_CMD_FRAGMENT;
+    downlink[1] = n >> 8;
+    downlink[2] = n & 0xFF;
+
+    if (n <= TEST_FRAGMENTS)
+    {
+        memcpy(downlink + 3, testImage + (n - 1) * TEST_FRAG_SIZE, TEST_FRAG_SIZE);
+    }
+    else
+    {
+        /* Same generator as the device, on a server side copy of the row */
+        fuotaParityRow(n - TEST_FRAGMENTS, TEST_FRAGMENTS);
+        memcpy(testParity, fuotaBuffers->parity, sizeof(testParity));
+        memset(downlink + 3, 0, TEST_FRAG_SIZE);
+        for (uint16_t i = 0; i < TEST_FRAGMENTS; i++)
+        {
+            if (fuotaBit(testParity, i))
+            {
+                fuotaXor(downlink + 3, testImage + i * TEST_FRAG_SIZE, TEST_FRAG_SIZE);
+            }
+        }
+    }
+    return 3 + TEST_FRAG_SIZE;
+}
+
+/* Setup is answered at once, the erase runs a sector per step and fragments wait for it */
+static void testErase()
+{
+    uint8_t downlink[3 + TEST_FRAG_SIZE];
+
+    testErases = 0;
+    TEST_CHECK(testSetup(0) == FUOTA_ERASING);
+    TEST_CHECK(testErases == 0);
+    TEST_CHECK(fuotaBuffers != NULL);
+
+    fuotaDownlink(downlink, testFragment(1, downlink));
+    TEST_CHECK(fuota.state == FUOTA_ERASING);
+    TEST_CHECK(fuota.received == 0);
+
+    uint32_t steps = testWork();
+    TEST_CHECK(fuota.state == FUOTA_RECEIVING);
+    TEST_CHECK(steps == fuota.eraseSize / FUOTA_SECTOR_SIZE);
+    TEST_CHECK(testErases == steps);
+
+    /* Bad setup ends the session and frees the buffers */
+    uint8_t setup[10] = {FUOTA_CMD_SETUP, 0};
+    TEST_CHECK(fuotaDownlink(setup, sizeof(setup)) == FUOTA_ERROR_SETUP);
+    TEST_CHECK(fuotaBuffers == NULL);
+}
+
+/* One session with a lost share of the fragments, returns the fragments sent */
+static uint32_t testSession(uint32_t seed, uint8_t lossPercent, uint32_t crc, uint8_t *state)
+{
+    uint8_t downlink[3 + TEST_FRAG_SIZE];
+    uint32_t sent = 0;
+
+    testWriteErrors = 0;
+    testActivated   = false;
+    testSetup(crc);
+    testWork();
+
+    /* Up to 3 x M fragments, the server stops on the COMPLETE status uplink */
+    for (uint16_t n = 1; n <= 3 * TEST_FRAGMENTS && fuota.state == FUOTA_RECEIVING; n++)
+    {
+        uint8_t len = testFragment(n, downlink);
+        sent++;
+
+        seed = seed * 1103515245UL + 12345;
+        if ((seed >> 16) % 100 < lossPercent)
+        {
+            continue;
+        }
+        fuotaDownlink(downlink, len);
+        testWork();
+    }
+    *state = fuota.state;
+    return sent;
+}
+
+static void testLoss()
+{
+    for (uint8_t loss = 10; loss <= 30; loss += 10)
+    {
+        uint32_t extra = 0;
+        uint8_t  completed = 0;
+
+        for (uint32_t run = 0; run < 10; run++)
+        {
+            srand(run * 7 + loss);
+            memset(testImage, 0, sizeof(testImage));
+            for (uint32_t i = 0; i < TEST_IMAGE_SIZE; i++)
+            {
+                testImage[i] = rand();
+            }
+
+            uint8_t  state;
+            uint32_t sent = testSession(run + loss, loss, fuotaCrc32(0, testImage, TEST_IMAGE_SIZE), &state);
+
+            TEST_CHECK(state == FUOTA_COMPLETE);
+            TEST_CHECK(testActivated);
+            TEST_CHECK(testWriteErrors == 0);
+            TEST_CHECK(memcmp(testFlash, testImage, TEST_IMAGE_SIZE) == 0);
+            TEST_CHECK(fuotaMissing() == 0);
+            TEST_CHECK(fuotaBuffers == NULL);
+
+            completed += (state == FUOTA_COMPLETE);
+            extra     += sent - TEST_FRAGMENTS;
+        }
+        printf(" [INFO] %-20s: %u%% lost, %u/10 rebuilt, %.1f%% extra fragments\n", "FUOTA session",
+               loss, completed, 100.0 * extra / (10 * TEST_FRAGMENTS));
+    }
+
+    /* Wrong CRC: checked in steps, not marked for boot */
+    uint8_t state;
+    testSession(1, 10, 0x12345678, &state);
+    TEST_CHECK(state == FUOTA_ERROR_CRC);
+    TEST_CHECK(!testActivated);
+    TEST_CHECK(fuotaBuffers == NULL);
+}
+
+int main()
+{
+    testErase();
+    testLoss();
+
+    return testResult("fuota");
+}
@@ -0,0 +1,396 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+/*
+ *  Join scheduler (_join.h): round channels stay on the 125 kHz channels of
+ *  every network profile, and a mass rejoin after a power restoration, 500
+ *  nodes on one 8 channel gateway, with and without the scheduler.
+ *
+ *  Gateway model: two join requests on the same channel and data rate that
+ *  overlap are both lost, the gateway does not hear while it sends a Join
+ *  Accept, and it sends one at a time in RX1 (5 s after the request).
+ *  Without the scheduler, LMiC retries on its own at DR5 a few seconds after
+ *  each RX2, as it does with no duty cycle limit (AU915).
+ */
+
+/* Includes */
+#include <algorithm>
+#include <queue>
+#include <vector>
+#include <lmic.h>
+#include "test.h"
+#include "_configurations.h"
+#include "_credentials.h"
+#include "_network_profiles.h"
+#include "_join.h"
+
+/* Definitions */
+#define TEST_NODES              500
+#define TEST_DURATION_MS        (2 * 3600000UL)
+#define TEST_RX1_MS             5000    /* JOIN_ACCEPT_DELAY1 */
+#define TEST_RX2_END_MS         7000    /* EV_JOIN_TXCOMPLETE after the RX2 window */
+#define TEST_ACCEPT_LENGTH      33      /* MHDR (1) + Join Accept (28) + MIC (4) */
+#define TEST_MAX_AIRTIME_MS     500     /* Longer than any join request at DR2 */
+
+#define TEST_EVENT_ROUND        0       /* joinfunc() */
+#define TEST_EVENT_TX           1       /* LMiC sends a join request */
+#define TEST_EVENT_RX1          2       /* Join Accept or not */
+
+/* Types */
+/* _join.h globals of one node */
+typedef struct
+{
+    u1_t round;
+    u1_t attempts;
+    bool paused;
+    u1_t channel;
+    u4_t airtimeTokens;
+    u4_t airtimeLast;
+} testJoinState_t;
+
+typedef struct
+{
+    testJoinState_t join;
+    u1_t channel;
+    u1_t dr;
+    bool joined;
+    u4_t joinedAt;
+    u4_t airtime;
+    u4_t requests;
+} testNode_t;
+
+typedef struct
+{
+    u4_t start;
+    u4_t end;
+    u1_t channel;
+    u1_t dr;
+} testTx_t;
+
+typedef struct
+{
+    u4_t time;
+    u2_t node;
+    u1_t type;
+    u4_t tx;                /* RX1: index in testTxs */
+} testEvent_t;
+
+struct testLater
+{
+    bool operator()(const testEvent_t &a, const testEvent_t &b) const
+    {
+        return a.time > b.time;
+    }
+};
+
+/* Variables */
+static testNode_t testNodes[TEST_NODES];
+static std::vector<testTx_t> testTxs;
+static std::vector<testTx_t> testAccepts;
+static std::priority_queue<testEvent_t, std::vector<testEvent_t>, testLater> testEvents;
+static u1_t testChannelsEnabled[JOIN_CHANNELS];
+static u1_t testChannelsCount;
+static u4_t testBadChannels;
+
+/* Functions */
+static void testLoad(const testNode_t *node)
+{
+    joinRound         = node->join.round;
+    joinAttempts      = node->join.attempts;
+    joinPaused        = node->join.paused;
+    joinChannel       = node->join.channel;
+    joinAirtimeTokens = node->join.airtimeTokens;
+    joinAirtimeLast   = node->join.airtimeLast;
+}
+
+static void testStore(testNode_t *node)
+{
+    node->join.round         = joinRound;
+    node->join.attempts      = joinAttempts;
+    node->join.paused        = joinPaused;
+    node->join.channel       = joinChannel;
+    node->join.airtimeTokens = joinAirtimeTokens;
+    node->join.airtimeLast   = joinAirtimeLast;
+}
+
+static void testSchedule(u4_t time, u2_t node, u1_t type, u4_t tx)
+{
+    testEvent_t event = {time, node, type, tx};
+    testEvents.push(event);
+}
+
+/* Both lost when they overlap on the same channel and data rate, or with a Join Accept */
+static bool testReceived(u4_t index)
+{
+    const testTx_t &tx = testTxs[index];
+
+    for (size_t i = testTxs.size(); i-- > 0 && testTxs[i].start + TEST_MAX_AIRTIME_MS > tx.start; )
+    {
+        const testTx_t &other = testTxs[i];
+        if (i != index && other.channel == tx.channel && other.dr == tx.dr
+            && other.start < tx.end && tx.start < other.end)
+        {
+            return false;
+        }
+    }
+    for (size_t i = testAccepts.size(); i-- > 0 && testAccepts[i].end > tx.start; )
+    {
+        if (testAccepts[i].start < tx.end)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Sends the Join Accept if the gateway is free, RX1 on BW500: a quarter of the BW125 airtime */
+static bool testAccept(u4_t now, u1_t dr)
+{
+    if (!testAccepts.empty() && testAccepts.back().end > now)
+    {
+        return false;
+    }
+    testTx_t accept = {now, now + airtimeMs(dr, TEST_ACCEPT_LENGTH) / 4, 0, 0};
+    testAccepts.push_back(accept);
+    return true;
+}
+
+static u1_t testRandomChannel()
+{
+    return testChannelsEnabled[random(testChannelsCount)];
+}
+
+/* Power restoration at 0, returns the join times sorted and the join requests sent */
+static std::vector<u4_t> testRejoin(bool scheduler, u4_t *requests)
+{
+    memset(testNodes, 0, sizeof(testNodes));
+    testTxs.clear();
+    testAccepts.clear();
+    srand(1);
+
+    for (u2_t n = 0; n < TEST_NODES; n++)
+    {
+        joinRound         = 0;
+        joinAttempts      = 0;
+        joinPaused        = false;
+        joinChannel       = 0xFF;
+        joinAirtimeTokens = JOIN_AIRTIME_BUDGET_MS;
+        joinAirtimeLast   = 0;
+        testStore(&testNodes[n]);
+
+        if (scheduler)
+        {
+            testSchedule(joinInitialDelayMs(), n, TEST_EVENT_ROUND, 0);
+        }
+        else
+        {
+            testNodes[n].channel = testRandomChannel();
+            testNodes[n].dr      = JOIN_DR_FASTEST;
+            testSchedule(random(1000), n, TEST_EVENT_TX, 0);
+        }
+    }
+
+    while (!testEvents.empty() && testEvents.top().time < TEST_DURATION_MS)
+    {
+        testEvent_t event = testEvents.top();
+        testEvents.pop();
+        testNode_t *node = &testNodes[event.node];
+
+        if (event.type == TEST_EVENT_ROUND)
+        {
+            testLoad(node);
+            node->channel = joinNextChannel();
+            node->dr      = joinRoundStart();
+            testStore(node);
+
+            testBadChannels += (node->channel >= JOIN_CHANNELS || !networkChannelEnabled(node->channel));
+            testSchedule(event.time, event.node, TEST_EVENT_TX, 0);
+        }
+        else if (event.type == TEST_EVENT_TX)
+        {
+            u4_t airtime = airtimeMs(node->dr, JOIN_REQUEST_LENGTH);
+            testTx_t tx = {event.time, event.time + airtime, node->channel, node->dr};
+            testTxs.push_back(tx);
+            node->airtime += airtime;
+            node->requests++;
+            testSchedule(tx.end + TEST_RX1_MS, event.node, TEST_EVENT_RX1, testTxs.size() - 1);
+        }
+        else if (testReceived(event.tx) && testAccept(event.time, node->dr))
+        {
+            node->joined   = true;
+            node->joinedAt = event.time;
+            if (scheduler)
+            {
+                testLoad(node);
+                joinSucceeded();
+                testStore(node);
+            }
+        }
+        else
+        {
+            /* EV_JOIN_TXCOMPLETE, LMiC retries on another channel unless the round is over */
+            u4_t now = event.time + TEST_RX2_END_MS - TEST_RX1_MS;
+            node->channel = testRandomChannel();
+
+            if (scheduler)
+            {
+                testLoad(node);
+                if (joinAttempt(node->dr, now))
+                {
+                    testSchedule(now + joinRoundFailed(now), event.node, TEST_EVENT_ROUND, 0);
+                }
+                else
+                {
+                    testSchedule(now + 1000 + random(2000), event.node, TEST_EVENT_TX, 0);
+                }
+                testStore(node);
+            }
+            else
+            {
+                testSchedule(now + 1000 + random(2000), event.node, TEST_EVENT_TX, 0);
+            }
+        }
+    }
+    while (!testEvents.empty())
+    {
+        testEvents.pop();
+    }
+
+    std::vector<u4_t> times;
+    *requests = 0;
+    for (u2_t n = 0; n < TEST_NODES; n++)
+    {
+        *requests += testNodes[n].requests;
+        if (testNodes[n].joined)
+        {
+            times.push_back(testNodes[n].joinedAt);
+        }
+    }
+    std::sort(times.begin(), times.end());
+    return times;
+}
+
+/* Round channels of every profile: enabled, 125 kHz, all of them in turn */
+static void testChannels()
+{
+    for (u1_t network = 0; network < NETWORKS_COUNT; network++)
+    {
+        networkSelect(network);
+        u1_t enabled = 0;
+        for (u1_t channel = 0; channel < JOIN_CHANNELS; channel++)
+        {
+            enabled += networkChannelEnabled(channel);
+        }
+
+        for (u4_t seed = 0; seed < 20; seed++)
+        {
+            srand(seed);
+            joinChannel = 0xFF;
+            u1_t seen[JOIN_CHANNELS] = {0};
+            u1_t distinct = 0;
+            bool bad = false;
+
+            for (u1_t round = 0; round < 3 * enabled; round++)
+            {
+                u1_t channel = joinNextChannel();
+                if (channel >= JOIN_CHANNELS || !networkChannelEnabled(channel))
+                {
+                    bad = true;
+                    break;
+                }
+                distinct += !seen[channel];
+                seen[channel] = 1;
+            }
+            TEST_CHECK(!bad);
+            TEST_CHECK(distinct == enabled);
+        }
+    }
+}
+
+static void testMassRejoin()
+{
+    networkSelect(NETWORK_PRIMARY);
+    testChannelsCount = 0;
+    for (u1_t channel = 0; channel < JOIN_CHANNELS; channel++)
+    {
+        if (networkChannelEnabled(channel))
+        {
+            testChannelsEnabled[testChannelsCount++] = channel;
+        }
+    }
+
+    u4_t leftRequests, scheduledRequests;
+    std::vector<u4_t> left = testRejoin(false, &leftRequests);
+    std::vector<u4_t> scheduled = testRejoin(true, &scheduledRequests);
+
+    /* The budget holds JOIN_AIRTIME_BUDGET_MS at start and refills as much per hour */
+    u4_t overBudget = 0;
+    for (u2_t n = 0; n < TEST_NODES; n++)
+    {
+        overBudget += testNodes[n].airtime > JOIN_AIRTIME_BUDGET_MS * (1 + TEST_DURATION_MS / JOIN_HOUR_MS);
+    }
+
+    TEST_CHECK(testBadChannels == 0);
+    TEST_CHECK(overBudget == 0);
+    TEST_CHECK(scheduled.size() == TEST_NODES);
+    TEST_CHECK(scheduledRequests < leftRequests);
+
+    /* Join time is only reported: the scheduler saves requests, the tail of the fleet joins later */
+
+    printf(" [INFO] %-20s: %u/%u joined, p50 %u s, p90 %u s, %u join requests\n", "Without scheduler", (unsigned)left.size(), TEST_NODES,
+           left.size() > TEST_NODES / 2 ? left[TEST_NODES / 2] / 1000 : 0,
+           left.size() > TEST_NODES * 9 / 10 ? left[TEST_NODES * 9 / 10] / 1000 : 0, leftRequests);
+    printf(" [INFO] %-20s: %u/%u joined, p50 %u s, p90 %u s, %u join requests\n", "With scheduler", (unsigned)scheduled.size(), TEST_NODES,
+           scheduled[TEST_NODES / 2] / 1000, scheduled[TEST_NODES * 9 / 10] / 1000, scheduledRequests);
+}
+
+int main()
+{
+    testChannels();
+    testMassRejoin();
+
+    return testResult("join");
+}
@@ -0,0 +1,256 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+
+/*
+ *  Regression test of the join and downlink paths against the network
+ *  server stand-in (_network_server.h): the node side is played here with
+ *  the same _crypto.h functions the sketch uses.
+ */
+
+/* Includes */
+#include <lmic.h>
+#include "test.h"
+#include "_configurations.h"
+#include "_credentials.h"
+#include "_network_server.h"
+
+/* The credentials of the primary network, as the sketch hands them to LMiC */
+static const uint8_t *testAppEui = APPEUI[NETWORK_PRIMARY];
+static const uint8_t *testDevEui = DEVEUI[NETWORK_PRIMARY];
+static const uint8_t *testAppKey = APPKEY[NETWORK_PRIMARY];
+
+/* Session of the simulated node */
+static uint32_t testDevAddr;
+static uint8_t  testNwkSKey[16];
+static uint8_t  testAppSKey[16];
+
+/* Defined in network_server_peer.cpp, a second translation unit */
+bool networkServerPeerCheck();
+
+static uint8_t testJoinRequest(uint16_t devNonce, uint8_t *frame)
+{
+    uint8_t mac[AES_BLOCK_SIZE];
+
+    frame[0] = NS_MTYPE_JOIN_REQUEST;
+    memcpy(&frame[1], testAppEui, 8);
+    memcpy(&frame[9], testDevEui, 8);
+    frame[17] = (uint8_t)(devNonce);
+    frame[18] = (uint8_t)(devNonce >> 8);
+    aesCmac(testAppKey, frame, 19, mac);
+    memcpy(&frame[19], mac, 4);
+    return 23;
+}
+
+static uint8_t testDataUplink(uint32_t fCnt, bool confirmed, uint8_t port, const char *text, uint8_t *frame)
+{
+    uint8_t len  = 0;
+    uint8_t size = (uint8_t)strlen(text);
+
+    frame[len++] = confirmed ? NS_MTYPE_CONFIRMED_UP : NS_MTYPE_UNCONFIRMED_UP;
+    networkServerPut32(&frame[len], testDevAddr);
+    len += 4;
+    frame[len++] = 0x00;
+    frame[len++] = (uint8_t)(fCnt);
+    frame[len++] = (uint8_t)(fCnt >> 8);
+    frame[len++] = port;
+    memcpy(&frame[len], text, size);
+    aesLoRaWANPayload(testAppSKey, testDevAddr, fCnt, 0, &frame[len], size);
+    len += size;
+    networkServerPut32(&frame[len], aesLoRaWANMic(testNwkSKey, testDevAddr, fCnt, 0, frame, len));
+    return len + 4;
+}
+
+/* Checks the MIC of a data downlink and decrypts its FRMPayload in place, returns the FRMPayload length */
+static uint8_t testDataDownlink(uint8_t *frame, uint8_t len, uint32_t fCntDown)
+{
+    uint32_t mic = aesLoRaWANMic(testNwkSKey, testDevAddr, fCntDown, 1, frame, len - 4);
+    TEST_CHECK(mic == networkServerGet32(&frame[len - 4]));
+    TEST_CHECK(networkServerGet32(&frame[1]) == testDevAddr);
+
+    uint8_t size = len - 4 - 9;
+    aesLoRaWANPayload(testAppSKey, testDevAddr, fCntDown, 1, &frame[9], size);
+    return size;
+}
+
+static void testJoin()
+{
+    uint8_t frame[NS_MAX_FRAME];
+    uint8_t mac[AES_BLOCK_SIZE];
+
+    networkServerInit(testAppEui, testDevEui, testAppKey, 1);
+
+    /* Tampered MIC */
+    uint8_t len = testJoinRequest(0x1234, frame);
+    frame[22] ^= 0x01;
+    TEST_CHECK(networkServerUplink(frame, len, 1000) == NS_UPLINK_MIC_ERROR);
+    TEST_CHECK(networkServer.micErrors == 1);
+
+    /* Join accept is offered in RX1 (5 s) and RX2 (6 s) only */
+    len = testJoinRequest(0x1234, frame);
+    TEST_CHECK(networkServerUplink(frame, len, 1000) == NS_UPLINK_JOINED);
+    TEST_CHECK(networkServerRxWindow(5500, frame) == 0);
+    TEST_CHECK(networkServerRxWindow(7500, frame) == 0);
+
+    len = testJoinRequest(0x1235, frame);
+    TEST_CHECK(networkServerUplink(frame, len, 10000) == NS_UPLINK_JOINED);
+    TEST_CHECK(networkServer.missedWindows == 1);
+    TEST_CHECK(networkServerRxWindow(15000 + NS_RX_WINDOW_TOLERANCE_MS, frame) == 17);
+    TEST_CHECK(networkServer.joinLatency.count == 1);
+    TEST_CHECK(networkServer.joinLatency.maxMs == 14000 + NS_RX_WINDOW_TOLERANCE_MS);
+
+    /* The node only has the forward cipher: encrypting undoes the server side decryption */
+    aesEncryptBlock(testAppKey, &frame[1], &frame[1]);
+    aesCmac(testAppKey, frame, 13, mac);
+    TEST_CHECK_BYTES(mac, &frame[13], 4);
+
+    testDevAddr = networkServerGet32(&frame[7]);
+    TEST_CHECK(testDevAddr == NS_DEVADDR_BASE + 2);
+    TEST_CHECK(frame[11] == NS_RX2_DATA_RATE);
+    TEST_CHECK(frame[12] == 1);
+
+    uint8_t block[AES_BLOCK_SIZE] = {0};
+    memcpy(&block[1], &frame[1], 6);
+    block[7] = 0x35;
+    block[8] = 0x12;
+    block[0] = 0x01;
+    aesEncryptBlock(testAppKey, block, testNwkSKey);
+    block[0] = 0x02;
+    aesEncryptBlock(testAppKey, block, testAppSKey);
+    TEST_CHECK_BYTES(testNwkSKey, networkServer.nwkSKey, 16);
+    TEST_CHECK_BYTES(testAppSKey, networkServer.appSKey, 16);
+
+    /* DevNonce reuse */
+    len = testJoinRequest(0x1235, frame);
+    TEST_CHECK(networkServerUplink(frame, len, 20000) == NS_UPLINK_REPLAY);
+}
+
+static void testDownlinks()
+{
+    uint8_t frame[NS_MAX_FRAME];
+    uint8_t len;
+
+    /* FPort 255, command 01 (uplink interval), queued before the uplink */
+    static const uint8_t command[5] = {0x55, 0x01, 0x00, 0x1E, 0xFF};
+    TEST_CHECK(networkServerQueueDownlink(255, command, 5, false, 30000));
+
+    len = testDataUplink(0, true, 1, "AdailSilva", frame);
+    TEST_CHECK(networkServerUplink(frame, len, 40000) == NS_UPLINK_OK);
+    TEST_CHECK(networkServer.uplinkPort == 1);
+    TEST_CHECK(networkServer.uplinkLen == 10);
+    TEST_CHECK_BYTES(networkServer.uplinkData, "AdailSilva", 10);
+
+    /* RX1 one second after the end of the uplink, confirmed uplink is ACKed */
+    len = networkServerRxWindow(41000, frame);
+    TEST_CHECK(len == 9 + 5 + 4);
+    TEST_CHECK(frame[0] == NS_MTYPE_UNCONFIRMED_DOWN);
+    TEST_CHECK(frame[5] == NS_FCTRL_ACK);
+    TEST_CHECK(frame[8] == 255);
+    TEST_CHECK(testDataDownlink(frame, len, 0) == 5);
+    TEST_CHECK_BYTES(&frame[9], command, 5);
+    TEST_CHECK(networkServerAverageMs(&networkServer.downlinkRoundTrip) == 11000);
+
+    /* Relay command 101, picked up in RX2 */
+    static const uint8_t relay[1] = {101};
+    TEST_CHECK(networkServerQueueDownlink(1, relay, 1, false, 50000));
+    len = testDataUplink(1, false, 1, "x", frame);
+    TEST_CHECK(networkServerUplink(frame, len, 60000) == NS_UPLINK_OK);
+    TEST_CHECK(networkServerRxWindow(61500, frame) == 0);
+    len = networkServerRxWindow(62000, frame);
+    TEST_CHECK(len == 9 + 1 + 4);
+    TEST_CHECK(frame[5] == 0x00);
+    TEST_CHECK(testDataDownlink(frame, len, 1) == 1);
+    TEST_CHECK(frame[9] == 101);
+
+    /* Nothing queued, unconfirmed: no downlink */
+    len = testDataUplink(2, false, 1, "y", frame);
+    TEST_CHECK(networkServerUplink(frame, len, 70000) == NS_UPLINK_OK);
+    TEST_CHECK(networkServerRxWindow(71000, frame) == 0);
+
+    /* Replayed frame counter fails the MIC check */
+    len = testDataUplink(2, false, 1, "y", frame);
+    TEST_CHECK(networkServerUplink(frame, len, 80000) == NS_UPLINK_MIC_ERROR);
+
+    /* Frame from another device */
+    len = testDataUplink(3, false, 1, "z", frame);
+    frame[1] ^= 0x01;
+    TEST_CHECK(networkServerUplink(frame, len, 90000) == NS_UPLINK_UNKNOWN_DEVICE);
+
+    /* Queue limit */
+    for (uint8_t i = 0; i < NS_DOWNLINK_QUEUE_SIZE; i++)
+    {
+        TEST_CHECK(networkServerQueueDownlink(1, relay, 1, false, 100000));
+    }
+    TEST_CHECK(!networkServerQueueDownlink(1, relay, 1, false, 100000));
+}
+
+static void testAbp()
+{
+    uint8_t frame[NS_MAX_FRAME];
+
+    networkServerInit(testAppEui, testDevEui, testAppKey, 1);
+    networkServerSetSession(0x26031234, testNwkSKey, testAppSKey);
+    testDevAddr = 0x26031234;
+
+    uint8_t len = testDataUplink(7, false, 2, "abp", frame);
+    TEST_CHECK(networkServerUplink(frame, len, 1000) == NS_UPLINK_OK);
+    TEST_CHECK(networkServer.fCntUp == 8);
+    TEST_CHECK_BYTES(networkServer.uplinkData, "abp", 3);
+}
+
+int main()
+{
+    TEST_CHECK(aesSelfTest());
+    testJoin();
+    testDownlinks();
+    testAbp();
+
+    /* The peer translation unit has its own server, untouched by the tests above */
+    TEST_CHECK(networkServerPeerCheck());
+    TEST_CHECK(networkServer.devAddr == 0x26031234);
+
+    return testResult("network_server");
+}
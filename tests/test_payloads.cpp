@@ -0,0 +1,150 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+
+/*
+ *  Payload templates (_payloads.h) and the sketch uplinks of _uplinks.h,
+ *  byte for byte against the frames documented next to each sender.
+ */
+
+/* Includes */
+#include <lmic.h>
+#include "test.h"
+#include "_configurations.h"
+#include "_uplinks.h"
+
+/* LMIC_setTxData2() of the model starts a join and reports it, no network is connected */
+void onEvent(ev_t ev) {}
+void os_getArtEui(u1_t *buf) {}
+void os_getDevEui(u1_t *buf) {}
+void os_getDevKey(u1_t *buf) {}
+
+static void testFields()
+{
+    u1_t buffer[32];
+
+    /* Big endian, truncated to the field size */
+    typedef payloadMessage<payloadUnsigned<1>, payloadUnsigned<2>, payloadUnsigned<3>, payloadUnsigned<4> > unsigned_t;
+    static const u1_t unsignedFrame[10] = {0x09, 0x08, 0xFD, 0x01, 0xE2, 0x40, 0xDE, 0xAD, 0xBE, 0xEF};
+    TEST_CHECK(unsigned_t::size == 10);
+    TEST_CHECK(unsigned_t::encode(buffer, 0x09, 2301, 123456, 0xDEADBEEF) == 10);
+    TEST_CHECK_BYTES(buffer, unsignedFrame, 10);
+
+    /* Two's complement with sign extension on decode */
+    typedef payloadMessage<payloadSigned<1>, payloadSigned<2>, payloadSigned<3> > signed_t;
+    static const u1_t signedFrame[6] = {0x80, 0xFF, 0xFB, 0x7F, 0xFF, 0xFF};
+    TEST_CHECK(signed_t::encode(buffer, -128, -5, 8388607) == 6);
+    TEST_CHECK_BYTES(buffer, signedFrame, 6);
+
+    int32_t a, b, c;
+    TEST_CHECK(signed_t::decode(buffer, &a, &b, &c) == 6);
+    TEST_CHECK(a == -128 && b == -5 && c == 8388607);
+
+    /* Text padded with zeros, no terminator on air */
+    typedef payloadMessage<payloadText<5>, payloadBytes<2> > text_t;
+    static const u1_t textFrame[7] = {0x61, 0x62, 0x00, 0x00, 0x00, 0xCA, 0xFE};
+    static const u1_t bytes[2] = {0xCA, 0xFE};
+    memset(buffer, 0xAA, sizeof(buffer));
+    TEST_CHECK(text_t::encode(buffer, "ab", bytes) == 7);
+    TEST_CHECK_BYTES(buffer, textFrame, 7);
+    TEST_CHECK(buffer[7] == 0xAA);
+
+    char text[6];
+    u1_t raw[2];
+    TEST_CHECK(text_t::decode(buffer, text, raw) == 7);
+    TEST_CHECK(strcmp(text, "ab") == 0);
+    TEST_CHECK_BYTES(raw, bytes, 2);
+
+    /* Longer text is cut at the field size */
+    typedef payloadMessage<payloadText<3> > short_t;
+    TEST_CHECK(short_t::encode(buffer, "abcdef") == 3);
+    TEST_CHECK_BYTES(buffer, "abc", 3);
+
+    /* Round trip of the mixed message */
+    typedef payloadMessage<payloadUnsigned<1>, payloadUnsigned<2>, payloadUnsigned<3>, payloadSigned<2>, payloadText<3> > mixed_t;
+    static const u1_t mixedFrame[11] = {0x09, 0x08, 0xFD, 0x01, 0xE2, 0x40, 0xFF, 0xFB, 0x61, 0x62, 0x00};
+    TEST_CHECK(mixed_t::encode(buffer, 0x09, 2301, 123456, -5, "ab") == 11);
+    TEST_CHECK_BYTES(buffer, mixedFrame, 11);
+
+    uint32_t flags, voltage, power;
+    int32_t  offset;
+    char     tag[4];
+    mixed_t::decode(buffer, &flags, &voltage, &power, &offset, tag);
+    TEST_CHECK(flags == 0x09 && voltage == 2301 && power == 123456 && offset == -5 && strcmp(tag, "ab") == 0);
+}
+
+/* Frames of the sketch, straight from LMIC.pendTxData */
+static void testUplinks()
+{
+    lmicMockReset();
+    payloadMyNameVerticalBytes();
+    static const u1_t myName[10] = {0x41, 0x64, 0x61, 0x69, 0x6C, 0x53, 0x69, 0x6C, 0x76, 0x61};
+    TEST_CHECK(LMIC.pendTxPort == UPLINK_PORT);
+    TEST_CHECK(LMIC.pendTxConf == UPLINK_CONFIRMED);
+    TEST_CHECK(LMIC.pendTxLen == 10);
+    TEST_CHECK_BYTES(LMIC.pendTxData, myName, 10);
+
+    lmicMockReset();
+    payloadRelayUplink();
+    static const u1_t relay[17] = {0x52, 0x65, 0x6C, 0x61, 0x79, 0x20, 0x75, 0x70, 0x6C, 0x69, 0x6E, 0x6B, 0x20, 0x2D, 0x20, 0x4F, 0x6B};
+    TEST_CHECK(LMIC.pendTxLen == 17);
+    TEST_CHECK_BYTES(LMIC.pendTxData, relay, 17);
+
+    /* payloadSend() copies from the caller */
+    lmicMockReset();
+    u1_t data[3] = {1, 2, 3};
+    payloadSend(7, data, 3, true);
+    TEST_CHECK(LMIC.pendTxPort == 7 && LMIC.pendTxConf == 1 && LMIC.pendTxLen == 3);
+    TEST_CHECK_BYTES(LMIC.pendTxData, data, 3);
+}
+
+int main()
+{
+    testFields();
+    testUplinks();
+
+    return testResult("payloads");
+}
@@ -0,0 +1,133 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+/*
+ *  Profiler (_profiler.h) on a virtual host clock: windows and calls that
+ *  span the 2^32 ns (4.3 s) mark, inclusive nested scopes, and the reset
+ *  done by profilerDump().
+ */
+
+/* Includes */
+#include "test.h"
+
+#define USE_PROFILER
+#define PROFILER_CLOCK_CUSTOM
+#include "_profiler.h"
+
+/* Variables */
+static uint64_t testNs;
+
+/* Functions */
+uint64_t profilerHostNs()
+{
+    return testNs;
+}
+
+/* A scope of durationMs, with an onEvent scope of innerMs inside */
+static void testRunloop(uint32_t durationMs, uint8_t ev, uint32_t innerMs)
+{
+    PROFILE_SCOPE(PROFILER_RUNLOOP);
+    {
+        PROFILE_SCOPE(PROFILER_EVENT(ev));
+        testNs += (uint64_t)innerMs * 1000000;
+    }
+    testNs += (uint64_t)(durationMs - innerMs) * 1000000;
+}
+
+/* Starts just before 2^32 ns, where the 32-bit clock wrapped */
+static void testWrap()
+{
+    testNs = 4290000000ULL;
+    profilerReset();
+
+    testRunloop(2, 5, 1);
+    testNs += 10000ULL * 1000000;
+    TEST_CHECK(PROFILER_MS() - profilerWindowMs == 10002);
+
+    /* One call longer than the wrap */
+    testRunloop(6000, 5, 5000);
+    const profilerScope_t *runloop = &profilerScopes[PROFILER_RUNLOOP];
+    const profilerScope_t *event   = &profilerScopes[PROFILER_EVENT(5)];
+    TEST_CHECK(runloop->calls == 2);
+    TEST_CHECK(runloop->ticks == 6002ULL * 1000000);
+    TEST_CHECK(runloop->maxTicks == 6000ULL * 1000000);
+    TEST_CHECK(event->calls == 2);
+    TEST_CHECK(event->ticks == 5001ULL * 1000000);
+    TEST_CHECK(PROFILER_MS() - profilerWindowMs == 16002);
+}
+
+/* Events past PROFILER_EVENTS share the first event scope */
+static void testEvents()
+{
+    profilerReset();
+    testRunloop(3, PROFILER_EVENTS + 3, 1);
+    TEST_CHECK(profilerScopes[PROFILER_EVENT_FIRST].calls == 1);
+    TEST_CHECK(PROFILER_EVENT(PROFILER_EVENTS - 1) < PROFILER_SCOPES);
+}
+
+/* Prints the window, then starts a new one */
+static void testDump()
+{
+    profilerReset();
+    for (uint8_t i = 0; i < 5; i++)
+    {
+        testRunloop(20, 10, 5);
+    }
+    testNs += 50ULL * 1000000;
+    profilerDump();
+
+    TEST_CHECK(profilerScopes[PROFILER_RUNLOOP].calls == 0);
+    TEST_CHECK(profilerWindowMs == PROFILER_MS());
+}
+
+int main()
+{
+    testWrap();
+    testEvents();
+    testDump();
+
+    return testResult("profiler");
+}
@@ -0,0 +1,187 @@
+/* 
+ *   
+ *  Project:          IoT Energy Meter with C/C++, Java/Spring, TypeScript/Angular and Dart/Flutter;
+ *  About:            End-to-end implementation of a LoRaWAN network for monitoring electrical quantities;
+ *  Version:          1.0;
+ *  Backend Mote:     ATmega328P/ESP32/ESP8266/ESP8285/STM32;
+ *  Radios:           RFM95w and LoRaWAN EndDevice Radioenge Module: RD49C;
+ *  Sensors:          Peacefair PZEM-004T 3.0 Version TTL-RTU kWh Meter;
+ *  Backend API:      Java with Framework: Spring Boot;
+ *  LoRaWAN Stack:    MCCI Arduino LoRaWAN Library (LMiC: LoRaWAN-MAC-in-C) version 3.0.99;
+ *  Activation mode:  Activation by Personalization (ABP) or Over-the-Air Activation (OTAA);
+ *  Author:           Adail dos Santos Silva
+ *  E-mail:           adail101@hotmail.com
+ *  WhatsApp:         +55 89 9 9433-7661
+ *  
+ *  WARNINGS:
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the “Software”), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *  
+ */
+
+/********************************************************************
+ _____              __ _                       _   _             
+/  __ \            / _(_)                     | | (_)            
+| /  \/ ___  _ __ | |_ _  __ _ _   _ _ __ __ _| |_ _  ___  _ __  
+| |    / _ \| '_ \|  _| |/ _` | | | | '__/ _` | __| |/ _ \| '_ \ 
+| \__/\ (_) | | | | | | | (_| | |_| | | | (_| | |_| | (_) | | | |
+ \____/\___/|_| |_|_| |_|\__, |\__,_|_|  \__,_|\__|_|\___/|_| |_|
+                          __/ |                                  
+                         |___/                                   
+********************************************************************/
+
+
+/*
+ *  The whole sketch on the host (sketch.sh) against the LMiC model of
+ *  stubs/lmic.cpp: checks that every path that resets LMiC queues an
+ *  uplink again (failover, supervisor rejoin), so the node does not stay
+ *  silent after it rejoins. Built with USE_SUPERVISOR.
+ *
+ *  testNetworkServer() puts _network_server.h on the air of the LMiC model:
+ *  the join, the FPort 255 command and the relay command 101 go through the
+ *  sketch's own handlers, with the keys of _credentials.h on both sides.
+ */
+
+/* Includes */
+#include "test.h"
+#include "sketch.cpp"
+#include "_network_server.h"
+
+/* setup() with an OTAA node, first frame queued and join started */
+static void testBoot()
+{
+    lmicMockReset();
+    setup();
+
+    TEST_CHECK(lmicMock.joinsStarted == 1);
+    TEST_CHECK(LMIC.opmode & OP_TXDATA);
+    TEST_CHECK(lmicMockJoinAccept());
+    TEST_CHECK(lmicMock.framesSent == 1);
+    TEST_CHECK(lmicMock.lastPort == UPLINK_PORT);
+}
+
+/* NETWORK_FAILOVER_JOIN_FAILURES join failures: the join on the backup network carries the first uplink */
+static void testFailover()
+{
+    lmicMockReset();
+    setup();
+    TEST_CHECK(networkCurrent == NETWORK_PRIMARY);
+
+    for (u1_t i = 0; i < NETWORK_FAILOVER_JOIN_FAILURES; i++)
+    {
+        onEvent(EV_JOIN_FAILED);
+    }
+    lmicMockRunFor(10);
+
+    TEST_CHECK(networkCurrent == NETWORK_BACKUP);
+    TEST_CHECK(lmicMock.joinsStarted == 2);
+    TEST_CHECK(LMIC.opmode & OP_TXDATA);
+    TEST_CHECK(lmicMockJoinAccept());
+    TEST_CHECK(lmicMock.framesSent == 1);
+
+    /* And the regular cadence goes on from EV_TXCOMPLETE */
+    lmicMockRunFor(TX_INTERVAL * 1000UL + 10);
+    TEST_CHECK(lmicMockTransmit());
+    TEST_CHECK(lmicMock.framesSent == 2);
+}
+
+/* OTAA join, then FPort 255 and relay downlinks, end to end against the network server stand-in */
+static void testNetworkServer()
+{
+    static const u1_t interval[5] = {0x55, 0x01, 0x00, 0x1E, 0xFF};
+    static const u1_t relay[1]    = {101};
+    unsigned int txInterval       = TX_INTERVAL;
+
+    lmicMockReset();
+    networkServerInit(APPEUI[NETWORK_PRIMARY], DEVEUI[NETWORK_PRIMARY], APPKEY[NETWORK_PRIMARY], RX_DELAY);
+    setup();
+    lmicMockConnect(networkServerUplink, networkServerRxWindow);
+
+    /* Join accept in RX1, then the first uplink and its RX windows */
+    lmicMockRunFor(8000);
+    TEST_CHECK(lmicMock.joinRequests == 1);
+    TEST_CHECK(networkServer.joinLatency.count == 1);
+    TEST_CHECK(LMIC.devaddr == networkServer.devAddr);
+    TEST_CHECK(lmicMock.framesSent == 1);
+    TEST_CHECK(networkServer.uplinkPort == UPLINK_PORT);
+    TEST_CHECK(networkServer.uplinkLen == 10);
+    TEST_CHECK_BYTES(networkServer.uplinkData, "AdailSilva", 10);
+    TEST_CHECK(networkServer.micErrors == 0);
+
+    /* New uplink interval, answered after the next uplink */
+    TEST_CHECK(networkServerQueueDownlink(255, interval, 5, false, millis()));
+    lmicMockRunFor(TX_INTERVAL * 1000UL + 1000);
+    TEST_CHECK(lmicMock.framesSent == 2);
+    TEST_CHECK(lmicMock.downlinks == 1);
+    TEST_CHECK(TX_INTERVAL == 30);
+
+    /* Relay: the answer to the downlink goes out right after the RX windows */
+    TEST_CHECK(networkServerQueueDownlink(1, relay, 1, false, millis()));
+    lmicMockRunFor(TX_INTERVAL * 1000UL + 3000);
+    TEST_CHECK(lmicMock.downlinks == 2);
+    TEST_CHECK(lmicMock.framesSent == 4);
+    TEST_CHECK(networkServer.uplinkLen == 17);
+    TEST_CHECK_BYTES(networkServer.uplinkData, "Relay uplink - Ok", 17);
+    TEST_CHECK(networkServer.fCntUp == LMIC.seqnoUp);
+
+    TX_INTERVAL = txInterval;
+}
+
+/* loop() on the virtual clock, the supervisor checks after each pass */
+static void testRunLoopFor(u4_t ms)
+{
+    for (u4_t i = 0; i < ms; i++)
+    {
+        runloop();
+        arduinoAdvanceUs(1000);
+    }
+}
+
+/* No EV_TXCOMPLETE for SUPERVISOR_MISSED_INTERVALS: CLEAR, then REJOIN, and the rejoin carries the report */
+static void testSupervisorRejoin()
+{
+    lmicMockReset();
+    setup();
+    TEST_CHECK(lmicMockJoinAccept());
+    TEST_CHECK(lmicMock.framesSent == 1);
+
+    /* The radio never sends again */
+    u4_t deadlineMs = (u4_t)SUPERVISOR_MISSED_INTERVALS * TX_INTERVAL * 1000;
+    testRunLoopFor(deadlineMs + 10);
+    TEST_CHECK(supervisorLevel == SUPERVISOR_LEVEL_CLEAR);
+    TEST_CHECK(lmicMock.joinsStarted == 1);
+
+    testRunLoopFor(deadlineMs + 10);
+    TEST_CHECK(supervisorLevel == SUPERVISOR_LEVEL_REJOIN);
+    TEST_CHECK(lmicMock.joinsStarted == 2);
+    TEST_CHECK(LMIC.opmode & OP_TXDATA);
+
+    TEST_CHECK(lmicMockJoinAccept());
+    TEST_CHECK(lmicMock.framesSent == 2);
+    TEST_CHECK(lmicMock.lastPort == SUPERVISOR_PORT);
+    TEST_CHECK(supervisorLevel == 0);
+}
+
+int main()
+{
+    testBoot();
+    testFailover();
+    testNetworkServer();
+    testSupervisorRejoin();
+
+    return testResult("sketch");
+}
@@ -0,0 +1,68 @@
+#!/bin/sh
+#
+#  Prepares MCCI LMiC for USE_LMIC_AES_HOOK (see _crypto.h).
+#
+#  LMiC compiles its own lmic_aes_encrypt() (Ideetron AES, src/aes/ideetron/
+#  AES-128_V10.cpp) unless USE_ORIGINAL_AES is defined, and os_aes() in
+#  src/aes/other.c calls it for every MIC and payload block. Without this
+#  patch the sketch cannot provide the function, so LMiC never uses the
+#  ESP32 AES engine.
+#
+#  The script wraps the Ideetron file in #if !defined(LMIC_AES_EXTERNAL) and
+#  defines LMIC_AES_EXTERNAL in project_config/lmic_project_config.h, the file
+#  already edited to select the region. Originals are kept as *.orig. Run it
+#  again after every library update, an already patched library is left as is.
+#
+#  Usage:   tools/lmic_aes_hook.sh [--revert] [MCCI_LoRaWAN_LMIC_library path]
+#
+
+REVERT=0
+if [ "$1" = "--revert" ]; then
+    REVERT=1
+    shift
+fi
+
+LIBRARY="${1:-${ARDUINO_LIBRARIES:-$HOME/Arduino/libraries}/MCCI_LoRaWAN_LMIC_library}"
+AES_FILE="$LIBRARY/src/aes/ideetron/AES-128_V10.cpp"
+CONFIG_FILE="$LIBRARY/project_config/lmic_project_config.h"
+MARKER="LMIC_AES_EXTERNAL"
+
+if [ ! -f "$AES_FILE" ] || [ ! -f "$CONFIG_FILE" ]; then
+    echo " [ERROR] MCCI LMiC not found in: $LIBRARY" >&2
+    exit 1
+fi
+
+if [ $REVERT -eq 1 ]; then
+    for file in "$AES_FILE" "$CONFIG_FILE"; do
+        if [ -f "$file.orig" ]; then
+            mv "$file.orig" "$file"
+        fi
+    done
+    echo " [INFO] LMiC AES hook removed: $LIBRARY"
+    exit 0
+fi
+
+if grep -q "$MARKER" "$AES_FILE"; then
+    echo " [INFO] LMiC already patched: $LIBRARY"
+    exit 0
+fi
+
+cp "$AES_FILE" "$AES_FILE.orig"
+cp "$CONFIG_FILE" "$CONFIG_FILE.orig"
+
+# config.h pulls lmic_project_config.h, so the guard sees LMIC_AES_EXTERNAL
+{
+    echo "#include \"../../lmic/config.h\""
+    echo "#if !defined($MARKER)      /* Provided by the sketch, see tools/lmic_aes_hook.sh */"
+    cat "$AES_FILE.orig"
+    echo ""
+    echo "#endif /* !$MARKER */"
+} > "$AES_FILE"
+
+{
+    cat "$CONFIG_FILE.orig"
+    echo ""
+    echo "#define $MARKER                 /* lmic_aes_encrypt() comes from the sketch (USE_LMIC_AES_HOOK) */"
+} > "$CONFIG_FILE"
+
+echo " [INFO] LMiC AES hook installed: $LIBRARY"